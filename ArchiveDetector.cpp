@@ -0,0 +1,253 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "ArchiveDetector.h"
+#include <QFile>
+#include <cstring>
+
+namespace {
+
+inline quint16 le16(const uchar *data) { return static_cast<quint16>(data[0] | (data[1] << 8)); }
+inline quint32 le32(const uchar *data) { return le16(data) | (static_cast<quint32>(le16(data + 2)) << 16); }
+
+//! standard CRC-32 (ARJ headers), bitwise as the headers are small
+quint32 crc32(const uchar *data, int size)
+{
+    quint32 crc = 0xFFFFFFFF;
+    for (int i = 0; i < size; ++i)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+const uchar sRar4Signature[] = {0x52, 0x61, 0x72, 0x21, 0x1A, 0x07, 0x00};
+const uchar sRar5Signature[] = {0x52, 0x61, 0x72, 0x21, 0x1A, 0x07, 0x01, 0x00};
+const uchar s7zSignature[]   = {0x37, 0x7A, 0xBC, 0xAF, 0x27, 0x1C};
+const char  sAceSignature[]  = "**ACE**";
+
+template<int N>
+inline bool startsWith(const uchar *data, int size, const uchar (&signature)[N])
+{
+    return size >= N && std::memcmp(data, signature, N) == 0;
+}
+
+}
+
+QByteArray ArchiveDetector::readHeader(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.read(sPeekSize);
+}
+
+ArchiveDetector::Detection ArchiveDetector::detect(const QByteArray &header)
+{
+    const uchar *data = reinterpret_cast<const uchar*>(header.constData());
+    int size = header.size() < sPeekSize ? header.size() : sPeekSize;
+
+    if (startsWith(data, size, sRar5Signature))
+        return _detectRar5(data, size);
+    else if (startsWith(data, size, sRar4Signature))
+        return _detectRar4(data, size);
+    else if (startsWith(data, size, s7zSignature))
+        return {ARCHIVE_TYPE::Z7, FIRST::YES}; // the other parts are raw slices
+    else if (size >= 18 && std::memcmp(data + 7, sAceSignature, 7) == 0)
+        return _detectAce(data, size);
+    else if (size >= 4 && data[0] == 0x60 && data[1] == 0xEA)
+        return _detectArj(data, size);
+
+    return {ARCHIVE_TYPE::UNKNOWN, FIRST::NO};
+}
+
+ArchiveDetector::Detection ArchiveDetector::detectName(const QString &fileName)
+{
+    const QChar *name = fileName.constData();
+    const int    size = fileName.size();
+
+    // name.rar, name.ace, name.arj, name.7z
+    Detection detection{ARCHIVE_TYPE::UNKNOWN, FIRST::NO, size, -1};
+    if (_endsWith(name, size, ".rar", 4))
+        detection = {ARCHIVE_TYPE::RAR, FIRST::YES, size - 4, -1};
+    else if (_endsWith(name, size, ".ace", 4))
+        return {ARCHIVE_TYPE::ACE, FIRST::YES, size - 4, -1};
+    else if (_endsWith(name, size, ".arj", 4))
+        return {ARCHIVE_TYPE::ARJ, FIRST::YES, size - 4, -1};
+    else if (_endsWith(name, size, ".7z", 3))
+        return {ARCHIVE_TYPE::Z7, FIRST::YES, size - 3, -1};
+
+    // volumes: <base>.(part)?([rac])?<digits>(.rar)?
+    bool rarExtension = detection.type == ARCHIVE_TYPE::RAR;
+    int end = rarExtension ? size - 4 : size, dot = end - 1;
+    while (dot >= 0 && name[dot] != '.')
+        --dot;
+    if (dot < 0)
+        return detection;
+    if (!rarExtension)
+        detection.baseSize = dot; // without the extension
+
+    int pos = dot + 1;
+    bool newRar = end - pos > 4 && _endsWith(name + pos, 4, "part", 4);
+    if (newRar)
+        pos += 4;
+
+    char letter = 0;
+    if (pos < end)
+    {
+        ushort c = name[pos].unicode() | 0x20; // lower case for the letters (the digits are unchanged)
+        if (c == 'r' || c == 'a' || c == 'c')
+        {
+            letter = static_cast<char>(c);
+            ++pos;
+        }
+    }
+
+    // the number must be only digits (number one being 0*1)
+    if (pos == end)
+        return detection;
+    bool numberOne = name[end - 1] == '1';
+    int  number    = 0;
+    for (int i = pos; i < end; ++i)
+    {
+        ushort c = name[i].unicode();
+        if (c < '0' || c > '9')
+            return detection;
+        if (c != '0' && i != end - 1)
+            numberOne = false;
+        if (number < sMaxVolume)
+            number = number * 10 + (c - '0');
+    }
+    detection.baseSize = dot;
+    detection.volume   = number;
+
+    if (newRar)
+        detection.type = ARCHIVE_TYPE::RAR;
+    else if (_endsWith(name, dot, ".7z", 3))
+        detection.type = ARCHIVE_TYPE::Z7;
+    else if (letter == 'r' || letter == 0)
+        detection.type = ARCHIVE_TYPE::RAR;
+    else if (letter == 'a')
+        detection.type = ARCHIVE_TYPE::ARJ;
+    else
+        detection.type = ARCHIVE_TYPE::ACE;
+
+    if (detection.type == ARCHIVE_TYPE::RAR || detection.type == ARCHIVE_TYPE::Z7)
+    {
+        if (rarExtension && !newRar)
+            detection.first = FIRST::YES;
+        else
+            detection.first = letter == 0 && numberOne ? FIRST::YES : FIRST::NO;
+    }
+    return detection;
+}
+
+ArchiveDetector::Detection ArchiveDetector::_detectRar4(const uchar *data, int size)
+{
+    // main header: CRC (2), type (1) = 0x73, flags (2), size (2)
+    const int mainPos = sizeof(sRar4Signature);
+    if (size < mainPos + 7 || data[mainPos + 2] != 0x73)
+        return {ARCHIVE_TYPE::RAR, FIRST::UNKNOWN};
+
+    quint16 flags = le16(data + mainPos + 3);
+    if (!(flags & 0x0001)) // MHD_VOLUME
+        return {ARCHIVE_TYPE::RAR, FIRST::YES};
+    if (flags & 0x0100) // MHD_FIRSTVOLUME (RAR 3.0+)
+        return {ARCHIVE_TYPE::RAR, FIRST::YES};
+    if (flags & 0x0010) // MHD_NEWNUMBERING: RAR 3.0+ would have set the first volume flag
+        return {ARCHIVE_TYPE::RAR, FIRST::NO};
+
+    // old volume: the first file header tells if it's continued from the previous one
+    int filePos = mainPos + le16(data + mainPos + 5);
+    if (size >= filePos + 5 && data[filePos + 2] == 0x74 && (le16(data + filePos + 3) & 0x0001)) // LHD_SPLIT_BEFORE
+        return {ARCHIVE_TYPE::RAR, FIRST::NO};
+
+    return {ARCHIVE_TYPE::RAR, FIRST::UNKNOWN};
+}
+
+ArchiveDetector::Detection ArchiveDetector::_detectRar5(const uchar *data, int size)
+{
+    // main header: CRC32, size, type = 1, flags, [extra area size], [data size], archive flags
+    int pos = sizeof(sRar5Signature) + 4;
+    quint64 headerSize = 0, type = 0, flags = 0, value = 0, archiveFlags = 0;
+    if (!_readVInt(data, size, pos, headerSize) || !_readVInt(data, size, pos, type) || type != 1
+            || !_readVInt(data, size, pos, flags))
+        return {ARCHIVE_TYPE::RAR, FIRST::UNKNOWN}; // encrypted headers...
+
+    if ((flags & 0x0001) && !_readVInt(data, size, pos, value))
+        return {ARCHIVE_TYPE::RAR, FIRST::UNKNOWN};
+    if ((flags & 0x0002) && !_readVInt(data, size, pos, value))
+        return {ARCHIVE_TYPE::RAR, FIRST::UNKNOWN};
+    if (!_readVInt(data, size, pos, archiveFlags))
+        return {ARCHIVE_TYPE::RAR, FIRST::UNKNOWN};
+
+    // the volume number is present in all the volumes but the first one
+    return {ARCHIVE_TYPE::RAR, (archiveFlags & 0x0002) ? FIRST::NO : FIRST::YES};
+}
+
+ArchiveDetector::Detection ArchiveDetector::_detectAce(const uchar *data, int size)
+{
+    Q_UNUSED(size) // at least 18 bytes
+    // main header: CRC (2), size (2), type (1), flags (2), **ACE** (7), versions (2), host (1), volume number (1)
+    return {ARCHIVE_TYPE::ACE, data[17] == 0 ? FIRST::YES : FIRST::NO};
+}
+
+ArchiveDetector::Detection ArchiveDetector::_detectArj(const uchar *data, int size)
+{
+    // main header: id (2), size (2), basic header (size), CRC32 of the basic header (4)
+    // the id alone is too weak: any file starting with 0x60 0xEA would be taken for an ARJ
+    int basicSize = le16(data + 2);
+    if (basicSize == 0 || basicSize > 2600 || size < 4 + basicSize + 4
+            || crc32(data + 4, basicSize) != le32(data + 4 + basicSize))
+        return {ARCHIVE_TYPE::UNKNOWN, FIRST::NO};
+
+    // skip the main header, its CRC and its extended headers to reach the first file header
+    int pos = 4 + basicSize + 4;
+    while (size >= pos + 2)
+    {
+        int extSize = le16(data + pos);
+        pos += 2;
+        if (extSize == 0)
+            break;
+        pos += extSize + 4;
+    }
+
+    // file header: id (2), size (2), first header size (1), versions (2), host (1), flags (1)
+    if (size >= pos + 9 && data[pos] == 0x60 && data[pos + 1] == 0xEA && (data[pos + 8] & 0x08)) // EXTFILE_FLAG
+        return {ARCHIVE_TYPE::ARJ, FIRST::NO};
+
+    return {ARCHIVE_TYPE::ARJ, FIRST::UNKNOWN};
+}
+
+bool ArchiveDetector::_readVInt(const uchar *data, int size, int &pos, quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; pos < size && shift < 64; shift += 7)
+    {
+        uchar byte = data[pos++];
+        value |= static_cast<quint64>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,91 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef ARCHIVEDETECTOR_H
+#define ARCHIVEDETECTOR_H
+#include "ArchiveType.h"
+#include <QByteArray>
+
+/*!
+ * \brief The ArchiveDetector class identifies the second archives by their first bytes
+ * (the names of the volumes are only used when the header can't tell)
+ *   - RAR4: signature then main header with the volume / first volume flags
+ *           (or the split flag of the first file header for old volumes)
+ *   - RAR5: signature then main header whose volume number is absent in the first volume
+ *   - 7z:   signature only in the first part of a split archive
+ *   - ACE:  **ACE** signature with the volume number in the main header
+ *   - ARJ:  header id and CRC32 of the main header (the first file header tells if it's continued)
+ * It never reads more than sPeekSize bytes per file.
+ * detectName classifies the volume names without any allocation (it's run on every unzipped file):
+ *   name.rar name.ace name.arj name.7z, name.partXX.rar, name.rXX name.aXX name.cXX name.XXX, name.7z.XXX
+ * and gives the base name shared by the volumes of a set (name, or name.7z for name.7z.XXX)
+ */
+class ArchiveDetector
+{
+public:
+    enum class FIRST : char {NO = 0, YES, UNKNOWN}; //!< is it the first volume
+
+    struct Detection
+    {
+        ARCHIVE_TYPE type;
+        FIRST        first;
+        int          baseSize = 0; //!< size of the base name of the volume set (detectName only)
+        int          volume   = -1; //!< number of the volume in its name (detectName only, -1 if none)
+    };
+
+    //! from the beginning of the file (only the first sPeekSize bytes are used)
+    static Detection detect(const QByteArray &header);
+    static QByteArray readHeader(const QString &filePath); //!< empty if the file can't be read
+
+    //! from the file name only (never FIRST::UNKNOWN)
+    static Detection detectName(const QString &fileName);
+
+    static constexpr int sPeekSize  = 4096; //!< one page
+    static constexpr int sMaxVolume = 1000000; //!< the volume numbers stop growing there
+
+private:
+    static Detection _detectRar4(const uchar *data, int size);
+    static Detection _detectRar5(const uchar *data, int size);
+    static Detection _detectAce(const uchar *data, int size);
+    static Detection _detectArj(const uchar *data, int size);
+
+    inline static bool _endsWith(const QChar *name, int size, const char *suffix, int suffixSize);
+
+    static bool _readVInt(const uchar *data, int size, int &pos, quint64 &value);
+};
+
+bool ArchiveDetector::_endsWith(const QChar *name, int size, const char *suffix, int suffixSize)
+{
+    if (size < suffixSize)
+        return false;
+    name += size - suffixSize;
+    for (int i = 0; i < suffixSize; ++i)
+    {
+        ushort c = name[i].unicode();
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        if (c != static_cast<uchar>(suffix[i]))
+            return false;
+    }
+    return true;
+}
+
+#endif // ARCHIVEDETECTOR_H
@@ -0,0 +1,48 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef ARCHIVETYPE_H
+#define ARCHIVETYPE_H
+#include <QString>
+
+//! the archive types handled by the extractors (zip for the first extraction, the others for the second)
+enum class ARCHIVE_TYPE {UNKNOWN = 0, RAR, ACE, ARJ, Z7, ZIP};
+
+inline QString archiveTypeName(ARCHIVE_TYPE type)
+{
+    switch (type) {
+    case ARCHIVE_TYPE::RAR:
+        return "RAR";
+    case ARCHIVE_TYPE::ACE:
+        return "ACE";
+    case ARCHIVE_TYPE::ARJ:
+        return "ARJ";
+    case ARCHIVE_TYPE::Z7:
+        return "7Z";
+    case ARCHIVE_TYPE::ZIP:
+        return "ZIP";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+#endif // ARCHIVETYPE_H
@@ -0,0 +1,110 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "ChromeTrace.h"
+#include "FolderReport.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+
+ChromeTrace::ChromeTrace():
+    _file(), _origin(0), _empty(true), _processes(), _threads()
+{}
+
+ChromeTrace::~ChromeTrace()
+{
+    close();
+}
+
+bool ChromeTrace::open(const QString &filePath)
+{
+    _file.setFileName(filePath);
+    if (!_file.open(QIODevice::WriteOnly|QIODevice::Text))
+        return false;
+
+    _origin = FolderReport::now();
+    _empty  = true;
+    _file.write("[");
+    return true;
+}
+
+void ChromeTrace::close()
+{
+    if (!_file.isOpen())
+        return;
+
+    _file.write("\n]\n");
+    _file.close();
+}
+
+void ChromeTrace::addSpan(int pid, qint64 tid, const QString &name, const QString &category,
+                          qint64 start, qint64 end, const QJsonObject &args)
+{
+    QJsonObject event{{"ph", "X"}, {"pid", pid}, {"tid", tid}, {"name", name}, {"cat", category},
+                      {"ts", _us(start)}, {"dur", qMax<qint64>(0, end - start) * 1000}};
+    if (!args.isEmpty())
+        event["args"] = args;
+    _write(event);
+}
+
+void ChromeTrace::addInstant(int pid, qint64 tid, const QString &name, const QString &category,
+                             qint64 time, const QJsonObject &args)
+{
+    QJsonObject event{{"ph", "i"}, {"s", "t"}, {"pid", pid}, {"tid", tid}, {"name", name}, {"cat", category},
+                      {"ts", _us(time)}};
+    if (!args.isEmpty())
+        event["args"] = args;
+    _write(event);
+}
+
+void ChromeTrace::nameProcess(int pid, const QString &name)
+{
+    if (_processes.contains(pid))
+        return;
+
+    _processes.insert(pid);
+    _write(QJsonObject{{"ph", "M"}, {"pid", pid}, {"name", "process_name"},
+                       {"args", QJsonObject{{"name", name}}}});
+    _write(QJsonObject{{"ph", "M"}, {"pid", pid}, {"name", "process_sort_index"},
+                       {"args", QJsonObject{{"sort_index", pid}}}});
+}
+
+void ChromeTrace::nameThread(int pid, qint64 tid, const QString &name)
+{
+    QPair<int, qint64> thread(pid, tid);
+    if (_threads.contains(thread))
+        return;
+
+    _threads.insert(thread);
+    _write(QJsonObject{{"ph", "M"}, {"pid", pid}, {"tid", tid}, {"name", "thread_name"},
+                       {"args", QJsonObject{{"name", name}}}});
+}
+
+void ChromeTrace::_write(const QJsonObject &event)
+{
+    if (!_file.isOpen())
+        return;
+
+    _file.write(_empty ? "\n" : ",\n");
+    _file.write(QJsonDocument(event).toJson(QJsonDocument::Compact));
+    _file.flush();
+    _empty = false;
+}
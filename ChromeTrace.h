@@ -0,0 +1,73 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef CHROMETRACE_H
+#define CHROMETRACE_H
+#include <QFile>
+#include <QSet>
+#include <QPair>
+class QJsonObject;
+
+/*!
+ * \brief The ChromeTrace class writes a timeline in the Trace Event format (--trace)
+ * that chrome://tracing and ui.perfetto.dev can open: a JSON array of events
+ * written as they come (the closing bracket is optional so a killed run stays readable)
+ * The events are built by FolderReport::trace: one "process" per worker slot
+ * with the stages of its folders and the lifetime of the extractors they spawn
+ */
+class ChromeTrace
+{
+private:
+    QFile                  _file;
+    qint64                 _origin;   //!< timestamp 0 (cf FolderReport::now)
+    bool                   _empty;    //!< no event written yet (no comma)
+    QSet<int>              _processes;
+    QSet<QPair<int, qint64>> _threads;
+
+public:
+    ChromeTrace();
+    ~ChromeTrace();
+
+    bool open(const QString &filePath);
+    void close();
+    inline QString errorString() const;
+
+    //! complete event ("X") from start to end (ms on the clock of FolderReport::now)
+    void addSpan(int pid, qint64 tid, const QString &name, const QString &category,
+                 qint64 start, qint64 end, const QJsonObject &args);
+    //! instant event ("i")
+    void addInstant(int pid, qint64 tid, const QString &name, const QString &category,
+                    qint64 time, const QJsonObject &args);
+
+    //! metadata event naming a process or a thread (once)
+    void nameProcess(int pid, const QString &name);
+    void nameThread(int pid, qint64 tid, const QString &name);
+
+private:
+    void _write(const QJsonObject &event);
+    inline qint64 _us(qint64 ms) const;
+};
+
+QString ChromeTrace::errorString() const { return _file.errorString(); }
+qint64 ChromeTrace::_us(qint64 ms) const { return (ms - _origin) * 1000; }
+
+#endif // CHROMETRACE_H
@@ -0,0 +1,112 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "DeviceScheduler.h"
+#include <QFile>
+
+#if defined(Q_OS_LINUX)
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#endif
+
+DeviceScheduler::DeviceScheduler():
+    _hddJobs(sDefaultHddJobs), _ssdJobs(sDefaultSsdJobs),
+    _running(), _rotational()
+{}
+
+bool DeviceScheduler::canStart(const QList<quint64> &devices)
+{
+    for (quint64 device : devices)
+    {
+        int limit = _limit(device);
+        if (limit > 0 && _running.value(device) >= limit)
+            return false;
+    }
+    return true;
+}
+
+void DeviceScheduler::acquire(const QList<quint64> &devices)
+{
+    for (quint64 device : devices)
+        ++_running[device];
+}
+
+void DeviceScheduler::release(const QList<quint64> &devices)
+{
+    for (quint64 device : devices)
+    {
+        auto it = _running.find(device);
+        if (it != _running.end() && --it.value() <= 0)
+            _running.erase(it);
+    }
+}
+
+bool DeviceScheduler::isRotational(quint64 device)
+{
+    auto it = _rotational.constFind(device);
+    if (it != _rotational.cend())
+        return it.value();
+
+    bool rotational = false;
+#if defined(Q_OS_LINUX)
+    // a partition has no queue: it's the one of its disk
+    QString sysPath = QString("/sys/dev/block/%1").arg(deviceName(device));
+    for (const QString &path : {QString("%1/queue/rotational").arg(sysPath), QString("%1/../queue/rotational").arg(sysPath)})
+    {
+        QFile file(path);
+        if (file.open(QIODevice::ReadOnly))
+        {
+            rotational = file.readAll().trimmed() == "1";
+            break;
+        }
+    }
+#endif
+    _rotational.insert(device, rotational);
+    return rotational;
+}
+
+quint64 DeviceScheduler::deviceOf(const QString &path)
+{
+#if defined(Q_OS_LINUX)
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) == 0)
+        return static_cast<quint64>(st.st_dev);
+#else
+    Q_UNUSED(path)
+#endif
+    return 0;
+}
+
+QString DeviceScheduler::deviceName(quint64 device)
+{
+#if defined(Q_OS_LINUX)
+    return QString("%1:%2").arg(major(device)).arg(minor(device));
+#else
+    return QString::number(device);
+#endif
+}
+
+int DeviceScheduler::_limit(quint64 device)
+{
+    if (device == 0)
+        return 0;
+    return isRotational(device) ? _hddJobs : _ssdJobs;
+}
@@ -0,0 +1,75 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef DEVICESCHEDULER_H
+#define DEVICESCHEDULER_H
+#include <QHash>
+#include <QList>
+#include <QString>
+
+/*!
+ * \brief The DeviceScheduler class limits the number of folders using the same device at once
+ * (the st_dev of their source and of the destination) so two releases are not read
+ * from the same spindle in parallel: --hdd-jobs for the rotational disks (HDD)
+ * and --ssd-jobs for the other devices (SSD, network...), none by default as the output
+ * is one device shared by all the folders (a limit also bounds --jobs)
+ * Ex0days interleaves the devices by skipping the folders whose devices are busy.
+ * The devices are identified on Linux only (elsewhere there is no limit)
+ */
+class DeviceScheduler
+{
+private:
+    int                  _hddJobs;    //!< 0: no limit
+    int                  _ssdJobs;    //!< 0: no limit
+    QHash<quint64, int>  _running;    //!< folders using each device
+    QHash<quint64, bool> _rotational; //!< cache of /sys/dev/block/<major>:<minor>/queue/rotational
+
+public:
+    DeviceScheduler();
+
+    inline void setLimits(int hddJobs, int ssdJobs);
+    inline void reset();
+
+    bool canStart(const QList<quint64> &devices);
+    void acquire(const QList<quint64> &devices);
+    void release(const QList<quint64> &devices);
+
+    bool isRotational(quint64 device);
+
+    static quint64 deviceOf(const QString &path); //!< 0 if unknown
+    static QString deviceName(quint64 device);     //!< major:minor
+
+    static constexpr int sDefaultHddJobs = 0; //!< no limit (opt-in)
+    static constexpr int sDefaultSsdJobs = 0;
+
+private:
+    int _limit(quint64 device);
+};
+
+void DeviceScheduler::setLimits(int hddJobs, int ssdJobs)
+{
+    _hddJobs = hddJobs;
+    _ssdJobs = ssdJobs;
+}
+
+void DeviceScheduler::reset() { _running.clear(); }
+
+#endif // DEVICESCHEDULER_H
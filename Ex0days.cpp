@@ -20,15 +20,26 @@
 //========================================================================
 
 #include "Ex0days.h"
+#include "FolderWorker.h"
+#include "FolderScanner.h"
+#include "FolderIndex.h"
+#include "FolderWatcher.h"
+#include "FolderReport.h"
+#include "ChromeTrace.h"
+#include "ProcessExtractor.h"
+#ifdef __USE_LIBARCHIVE__
+#include "LibArchiveExtractor.h"
+#endif
 #include "MainWindow.h"
 #include "About.h"
 #include <QApplication>
 #include <QCommandLineParser>
-#include <QRegularExpression>
 #include <QDir>
 #include <QTime>
 #include <cmath>
+#include <algorithm>
 #include <QSettings>
+#include <QStorageInfo>
 #include <QDebug>
 #include <QDesktopServices>
 #include <QUrl>
@@ -44,6 +55,27 @@ const QMap<Ex0days::Opt, QString> Ex0days::sOptionNames =
     {Opt::OUTPUT,  "output"},
     {Opt::TEST,    "test"},
     {Opt::DEL,     "del"},
+    {Opt::JOBS,    "jobs"},
+    {Opt::NO_COPY, "no-copy"},
+    {Opt::IN_PLACE,"in-place"},
+    {Opt::HARDLINK,"hardlink"},
+    {Opt::BATCH_UNZIP, "batch-unzip"},
+    {Opt::UNZIP_JOBS,  "unzip-jobs"},
+    {Opt::MAX_PROCS,   "max-procs"},
+    {Opt::THREADS,     "threads"},
+    {Opt::INPROC,      "inproc"},
+    {Opt::STREAM,      "stream"},
+    {Opt::STAGING_DIR,    "staging"},
+    {Opt::STAGING_BUDGET, "staging-budget"},
+    {Opt::HEADROOM,       "headroom"},
+    {Opt::ORDER,          "order"},
+    {Opt::HDD_JOBS,       "hdd-jobs"},
+    {Opt::SSD_JOBS,       "ssd-jobs"},
+    {Opt::ADAPTIVE,       "adaptive"},
+    {Opt::FORCE,          "force"},
+    {Opt::WATCH,          "watch"},
+    {Opt::RESUME,         "resume"},
+    {Opt::TRACE,          "trace"},
     {Opt::Z7,      "7z"},
     {Opt::UNRAR,   "unrar"},
     {Opt::UNACE,   "unace"}
@@ -57,11 +89,39 @@ const QList<QCommandLineOption> Ex0days::sCmdOptions = {
     {{"o", sOptionNames[Opt::OUTPUT]},    tr("output folder (or temporary)"), sOptionNames[Opt::OUTPUT]},
     {{"t", sOptionNames[Opt::TEST]},      tr("test only")},
     {{"d", sOptionNames[Opt::DEL]},       tr("delete sources once extracted")},
+    {{"j", sOptionNames[Opt::JOBS]},      tr("number of folders processed in parallel (default: 1)"), sOptionNames[Opt::JOBS]},
+    {sOptionNames[Opt::ADAPTIVE],         tr("adapt the number of folders processed in parallel to the throughput (between 1 and --jobs, default: nb cores)")},
+    {sOptionNames[Opt::NO_COPY],          tr("unzip straight from the source folders (no copy of the zips)")},
+    {sOptionNames[Opt::IN_PLACE],         tr("move the zips in the output folder instead of copying them (needs --del and the same filesystem)")},
+    {sOptionNames[Opt::HARDLINK],         tr("hardlink the zips instead of copying them when the output is on the same device")},
+    {sOptionNames[Opt::BATCH_UNZIP],      tr("unzip all the zips of a folder with a single 7z command")},
+    {sOptionNames[Opt::UNZIP_JOBS],       tr("number of zips of a folder unzipped in parallel (default: 1)"), sOptionNames[Opt::UNZIP_JOBS]},
+    {sOptionNames[Opt::MAX_PROCS],        tr("max number of extraction processes for all the jobs (default: nb cores)"), sOptionNames[Opt::MAX_PROCS]},
+    {sOptionNames[Opt::THREADS],          tr("number of threads shared by the 7z and unrar processes (-mmt/-mt) (default: nb cores)"), sOptionNames[Opt::THREADS]},
+    {sOptionNames[Opt::INPROC],           tr("archive types extracted in process with libarchive (comma separated: zip,rar,7z)"), sOptionNames[Opt::INPROC]},
+    {sOptionNames[Opt::STAGING_DIR],      tr("folder for the unzipped volumes before the second extraction (tmpfs...)"), sOptionNames[Opt::STAGING_DIR]},
+    {sOptionNames[Opt::STAGING_BUDGET],   tr("max size in MB of the staging folder (default: its free space)"), sOptionNames[Opt::STAGING_BUDGET]},
+    {sOptionNames[Opt::ORDER],            tr("order of the folders waiting to be extracted: fifo (default), largest, smallest or newest"), sOptionNames[Opt::ORDER]},
+    {sOptionNames[Opt::HDD_JOBS],         tr("max number of folders read from or written to the same hard disk, the output included (default: no limit)"), sOptionNames[Opt::HDD_JOBS]},
+    {sOptionNames[Opt::SSD_JOBS],         tr("max number of folders read from or written to the same SSD or other device, the output included (default: no limit)"), sOptionNames[Opt::SSD_JOBS]},
+    {sOptionNames[Opt::HEADROOM],         tr("free space in MB to keep in the output and staging filesystems (default: 512)"), sOptionNames[Opt::HEADROOM]},
+    {sOptionNames[Opt::FORCE],            tr("process again the folders that are unchanged since their last success")},
+    {sOptionNames[Opt::WATCH],            tr("keep running and extract the new folders once their zips are stable for <interval> seconds"), "interval"},
+    {sOptionNames[Opt::RESUME],           tr("resume the job that has been interrupted (its input folders are used if none is given)")},
+    {sOptionNames[Opt::TRACE],            tr("write the timeline of the stages of each folder in a Chrome trace (chrome://tracing or ui.perfetto.dev)"), "file"},
+    {sOptionNames[Opt::STREAM],           tr("unzip in memory and extract the rar/7z volumes from there (no intermediate files)")},
     {sOptionNames[Opt::Z7],               tr("7z full path"), sOptionNames[Opt::Z7]},
     {sOptionNames[Opt::UNRAR],            tr("unrar full path"), sOptionNames[Opt::UNRAR]},
     {sOptionNames[Opt::UNACE],            tr("unace full path"), sOptionNames[Opt::UNACE]}
 };
 
+const QMap<Ex0days::ORDER, QString> Ex0days::sOrderNames = {
+    {ORDER::FIFO,     "fifo"},
+    {ORDER::LARGEST,  "largest"},
+    {ORDER::SMALLEST, "smallest"},
+    {ORDER::NEWEST,   "newest"}
+};
+
 const QMap<Ex0days::Param, QString> Ex0days::sParamValues = {
     {Param::cmd7z,    "cmd7z"},
     {Param::cmdRar,   "cmdRar"},
@@ -71,19 +131,18 @@ const QMap<Ex0days::Param, QString> Ex0days::sParamValues = {
     {Param::testOnly, "testOnly"},
     {Param::delSrc,   "delSrc"},
     {Param::debug,    "debug"},
-    {Param::dispPaths,"dispPaths"}
+    {Param::dispPaths,"dispPaths"},
+    {Param::nbJobs,   "nbJobs"}
 };
 
-const QStringList Ex0days::s7zArgs = {"x", "-y"};
+volatile std::sig_atomic_t Ex0days::sShutdownRequests = 0;
 
-const QRegularExpression Ex0days::sRegExpArchiveExtensions = QRegularExpression("^.*\\.(rar|ace|arj|7z)$");
-const QRegularExpression Ex0days::sRegExpArchiveFiles      = QRegularExpression("^(.*)\\.(part)?(([rac])?\\d+)(\\.rar)?$");
-const QRegularExpression Ex0days::sRegExpNumberOne         = QRegularExpression("^0*1$");
+const QStringList Ex0days::s7zArgs     = {"x", "-y"};
+const QStringList Ex0days::s7zTestArgs = {"t", "-y"};
 
 
 Ex0days::Ex0days(int &argc, char *argv[]):
     QObject(), CmdOrGuiApp (argc, argv),
-    _state(STATE::IDLE),
 #if defined(WIN32) || defined(__MINGW64__)
     _7zCmd("./7z.exe"), _unrarCmd("./unrar.exe"), _unaceCmd("./unace.exe"), _arjCmd("./arj.exe"),
 #else
@@ -91,19 +150,26 @@ Ex0days::Ex0days(int &argc, char *argv[]):
 #endif
     _dstDir(nullptr),
     _cout(stdout), _cerr(stderr),
-    _extProc(),
     _foldersToExtract(),
-    _srcDir(nullptr),
-    _zipFiles(), _currentZip(),
-    _fistArchive(),
-    _archiveType(ARCHIVE_TYPE::UNKNOWN),
-    _unzippedFiles(),
+    _scanThread(), _scanner(nullptr),
+    _index(new FolderIndex(QString("%1/%2_index.tsv").arg(sLogFolder).arg(sAppName))), _force(false), _nbSkipped(0),
+    _watcher(nullptr), _watchScan(false), _jobRunning(false),
+    _journal(new FolderJournal(QString("%1/%2.journal").arg(sLogFolder).arg(sAppName))), _queuedPaths(),
+    _shutdownTimer(), _shutdownHandled(0), _draining(false),
+    _scanId(0), _scanning(false), _nbFolders(0),
+    _workers(), _nbJobs(1), _adaptive(false), _jobController(), _nbProcessed(0), _bytesTotal(0), _bytesDone(0), _nbRunning(0),
+    _unzipJobs(1), _maxProcs(0), _nbExtraProcs(0),
+    _threadBudget(0), _threadsUsed(0),
+    _inProcTypes(), _extractPool(), _stream(false),
+    _stagingPath(), _stagingBudget(0), _stagingUsed(0),
+    _dstReserved(0), _stagingFree(0), _dstFree(0), _headroom(sDefaultHeadroom * 1024 * 1024), _waitingForSpace(false),
+    _order(ORDER::FIFO), _devices(), _dstDevice(0),
     _timeStart(),
     _settings(nullptr),
     _stopProcess(false),
-    _testOnly(false), _delSrc(false),
+    _testOnly(false), _delSrc(false), _staging(STAGING::COPY), _allowHardlink(false), _batchUnzip(false),
     _debug(false),
-    _logFile(nullptr), _logStream(),
+    _logFile(nullptr), _logStream(), _reportFile(nullptr), _trace(nullptr), _runStats(),
     _useWinrar(false), _nbFailed(0)
 {
 #if defined(WIN32) || defined(__MINGW64__) || defined(__MINGW32__)
@@ -121,25 +187,36 @@ Ex0days::Ex0days(int &argc, char *argv[]):
 
     // queued to let hand to the HMI and avoid stack overflow ;)
     connect(this, &Ex0days::processNextFolder, this, &Ex0days::onProcessNextFolder, Qt::QueuedConnection);
-    connect(this, &Ex0days::unzipNext,         this, &Ex0days::onUnzipNextFile,     Qt::QueuedConnection);
 
-
-    connect(&_extProc, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
-            this, &Ex0days::onProcFinished);
+    // the discovery runs in its own thread and feeds _foldersToExtract
+    qRegisterMetaType<FolderEntry>("FolderEntry");
+    _scanner = new FolderScanner(_index);
+    _scanner->moveToThread(&_scanThread);
+    connect(&_scanThread, &QThread::finished,    _scanner, &QObject::deleteLater);
+    connect(this,     &Ex0days::scanFolders,       _scanner, &FolderScanner::onScanFolders, Qt::QueuedConnection);
+    connect(_scanner, &FolderScanner::folderFound, this,     &Ex0days::onFolderFound,       Qt::QueuedConnection);
+    connect(_scanner, &FolderScanner::folderSkipped, this,   &Ex0days::onFolderSkipped,     Qt::QueuedConnection);
+    connect(_scanner, &FolderScanner::scanDone,    this,     &Ex0days::onScanDone,          Qt::QueuedConnection);
+    _scanThread.start();
+
+    // the signal handler can't do anything but set a flag
+    connect(&_shutdownTimer, &QTimer::timeout, this, &Ex0days::onShutdownCheck);
+    _shutdownTimer.start(sShutdownPollMs);
 
     _loadSettings();
 }
 
 Ex0days::~Ex0days()
 {
-    if (_extProc.state()!= QProcess::NotRunning)
-    {
-        _extProc.terminate();
-        _extProc.waitForFinished();
-    }
-
-    _clearDir();
+    _stopProcess = true;
+    _scanner->stop(_scanId);
+    _scanThread.quit();
+    _scanThread.wait();
+    _deleteWorkers();
     _clearLogFile();
+    delete _trace; // closes the timeline
+    delete _index;
+    delete _journal;
 
     if (_hmi)
         _hmi->saveParams();
@@ -218,6 +295,188 @@ bool Ex0days::parseCommandLine(int argc, char *argv[])
         }
     }
 
+    if (parser.isSet(sOptionNames[Opt::NO_COPY]) && parser.isSet(sOptionNames[Opt::IN_PLACE]))
+    {
+        _error(tr("--%1 and --%2 can't be used together...").arg(
+                   sOptionNames[Opt::NO_COPY]).arg(sOptionNames[Opt::IN_PLACE]));
+        return false;
+    }
+    if (parser.isSet(sOptionNames[Opt::NO_COPY]))
+    {
+        _log(tr("No copy: unzipping straight from the source folders"));
+        _staging = STAGING::NO_COPY;
+    }
+    if (parser.isSet(sOptionNames[Opt::IN_PLACE]))
+    {
+        if (!_delSrc)
+        {
+            _error(tr("--%1 is only possible when deleting the sources (--%2)").arg(
+                       sOptionNames[Opt::IN_PLACE]).arg(sOptionNames[Opt::DEL]));
+            return false;
+        }
+        _log(tr("In place: moving the zips in the output folder"));
+        _staging = STAGING::MOVE;
+    }
+
+    if (parser.isSet(sOptionNames[Opt::HARDLINK]))
+    {
+        _log(tr("Hardlinking the zips when possible"));
+        _allowHardlink = true;
+    }
+
+    if (parser.isSet(sOptionNames[Opt::BATCH_UNZIP]))
+    {
+        _log(tr("Unzipping each folder with a single 7z command"));
+        _batchUnzip = true;
+    }
+
+    if (parser.isSet(sOptionNames[Opt::JOBS]))
+    {
+        bool ok = false;
+        int nbJobs = parser.value(sOptionNames[Opt::JOBS]).toInt(&ok);
+        if (!ok || !setNbJobs(nbJobs))
+        {
+            _error(tr("The number of jobs should be an integer between 1 and %1").arg(sMaxJobs));
+            return false;
+        }
+        if (_nbJobs > 1 && !parser.isSet(sOptionNames[Opt::ADAPTIVE]))
+            _log(tr("Processing %1 folders in parallel").arg(_nbJobs));
+    }
+    if (parser.isSet(sOptionNames[Opt::ADAPTIVE]))
+    {
+        _adaptive = true;
+        if (!parser.isSet(sOptionNames[Opt::JOBS]))
+            setNbJobs(qMin(sMaxJobs, QThread::idealThreadCount()));
+        _log(tr("Processing between 1 and %1 folders in parallel depending on the throughput").arg(_nbJobs));
+    }
+
+    if (parser.isSet(sOptionNames[Opt::UNZIP_JOBS]))
+    {
+        bool ok = false;
+        _unzipJobs = parser.value(sOptionNames[Opt::UNZIP_JOBS]).toInt(&ok);
+        if (!ok || _unzipJobs < 1 || _unzipJobs > sMaxJobs)
+        {
+            _error(tr("The number of unzip jobs should be an integer between 1 and %1").arg(sMaxJobs));
+            return false;
+        }
+    }
+
+    if (parser.isSet(sOptionNames[Opt::MAX_PROCS]))
+    {
+        bool ok = false;
+        _maxProcs = parser.value(sOptionNames[Opt::MAX_PROCS]).toInt(&ok);
+        if (!ok || _maxProcs < 1)
+        {
+            _error(tr("The max number of processes should be a positive integer"));
+            return false;
+        }
+    }
+
+    if (parser.isSet(sOptionNames[Opt::TRACE]))
+    {
+        _trace = new ChromeTrace;
+        if (!_trace->open(parser.value(sOptionNames[Opt::TRACE])))
+        {
+            _error(tr("Error creating the trace file: %1").arg(_trace->errorString()));
+            return false;
+        }
+        _log(tr("Writing the timeline in %1").arg(parser.value(sOptionNames[Opt::TRACE])));
+    }
+
+    if (parser.isSet(sOptionNames[Opt::THREADS]))
+    {
+        bool ok = false;
+        _threadBudget = parser.value(sOptionNames[Opt::THREADS]).toInt(&ok);
+        if (!ok || _threadBudget < 1)
+        {
+            _error(tr("The number of threads should be a positive integer"));
+            return false;
+        }
+    }
+
+    if (parser.isSet(sOptionNames[Opt::INPROC]) && !_setInProcTypes(parser.value(sOptionNames[Opt::INPROC])))
+        return false;
+
+    if (parser.isSet(sOptionNames[Opt::STREAM]))
+    {
+#ifdef __USE_LIBARCHIVE__
+        _log(tr("Streaming: the zips are unzipped in memory (up to %1 MB per folder)").arg(sMaxStreamSize / 1024 / 1024));
+        _stream = true;
+#else
+        _error(tr("--%1 is not available: %2 has been built without libarchive").arg(
+                   sOptionNames[Opt::STREAM]).arg(sAppName));
+        return false;
+#endif
+    }
+
+    if (parser.isSet(sOptionNames[Opt::FORCE]))
+    {
+        _log(tr("Forcing the processing of all the folders"));
+        _force = true;
+    }
+
+    if (parser.isSet(sOptionNames[Opt::STAGING_DIR]))
+    {
+        QFileInfo fi(parser.value(sOptionNames[Opt::STAGING_DIR]));
+        if (!fi.exists() || !fi.isDir() || !fi.isWritable())
+        {
+            _error(tr("Please provide a writable directory for the staging"));
+            return false;
+        }
+        _stagingPath = fi.absoluteFilePath();
+        _log(tr("Unzipping in the staging folder: %1").arg(_stagingPath));
+    }
+    if (parser.isSet(sOptionNames[Opt::STAGING_BUDGET]))
+    {
+        bool ok = false;
+        _stagingBudget = parser.value(sOptionNames[Opt::STAGING_BUDGET]).toLongLong(&ok) * 1024 * 1024;
+        if (!ok || _stagingBudget <= 0 || _stagingPath.isEmpty())
+        {
+            _error(tr("The staging budget should be a positive number of MB (with --%1)").arg(sOptionNames[Opt::STAGING_DIR]));
+            return false;
+        }
+    }
+    if (parser.isSet(sOptionNames[Opt::HEADROOM]))
+    {
+        bool ok = false;
+        _headroom = parser.value(sOptionNames[Opt::HEADROOM]).toLongLong(&ok) * 1024 * 1024;
+        if (!ok || _headroom < 0)
+        {
+            _error(tr("The headroom should be a number of MB"));
+            return false;
+        }
+    }
+    if (parser.isSet(sOptionNames[Opt::ORDER]))
+    {
+        QString order = parser.value(sOptionNames[Opt::ORDER]).toLower();
+        if (!sOrderNames.values().contains(order))
+        {
+            _error(tr("The order should be one of: %1").arg(QStringList(sOrderNames.values()).join(", ")));
+            return false;
+        }
+        _order = sOrderNames.key(order);
+        if (_order != ORDER::FIFO)
+            _log(tr("Extracting the folders in %1 order").arg(order));
+    }
+    int hddJobs = DeviceScheduler::sDefaultHddJobs, ssdJobs = DeviceScheduler::sDefaultSsdJobs;
+    for (Opt opt : {Opt::HDD_JOBS, Opt::SSD_JOBS})
+    {
+        if (!parser.isSet(sOptionNames[opt]))
+            continue;
+        bool ok = false;
+        int nbJobs = parser.value(sOptionNames[opt]).toInt(&ok);
+        if (!ok || nbJobs < 0)
+        {
+            _error(tr("--%1 should be a positive number (0: no limit)").arg(sOptionNames[opt]));
+            return false;
+        }
+        (opt == Opt::HDD_JOBS ? hddJobs : ssdJobs) = nbJobs;
+        if (nbJobs > 0 && nbJobs < _nbJobs)
+            _log(tr("Warning: --%1 %2 is lower than --%3 %4: the folders sharing a device (the output included) will be limited to %2").arg(
+                     sOptionNames[opt]).arg(nbJobs).arg(sOptionNames[Opt::JOBS]).arg(_nbJobs));
+    }
+    _devices.setLimits(hddJobs, ssdJobs);
+
     if (!parser.isSet(sOptionNames[Opt::INPUT]) && !parser.isSet(sOptionNames[Opt::OUTPUT]) )
     {
         _error(tr("Error syntax: you should provide at least one input folder and the output directory"));
@@ -246,6 +505,8 @@ bool Ex0days::parseCommandLine(int argc, char *argv[])
         return false;
     }
 
+    FolderJournal::Recovery recovery = _recoverPreviousJob();
+
     QStringList srcFolders;
     for (const QString &path : parser.values(sOptionNames[Opt::INPUT]))
     {
@@ -259,7 +520,30 @@ bool Ex0days::parseCommandLine(int argc, char *argv[])
         }
     }
 
-    processFolders(srcFolders);
+    if (parser.isSet(sOptionNames[Opt::WATCH]))
+    {
+        bool ok = false;
+        int interval = parser.value(sOptionNames[Opt::WATCH]).toInt(&ok);
+        if (!ok || interval < 1)
+        {
+            _error(tr("The watch interval should be a positive number of seconds"));
+            return false;
+        }
+        _startWatching(srcFolders, interval); // the interrupted folders will be found by the first scan
+    }
+    else if (parser.isSet(sOptionNames[Opt::RESUME]))
+    {
+        if (recovery.roots.isEmpty())
+        {
+            _error(tr("There is no interrupted job to resume"));
+            return false;
+        }
+        if (!srcFolders.isEmpty())
+            recovery.roots = srcFolders;
+        _resumeJob(recovery);
+    }
+    else
+        processFolders(srcFolders);
 
     return true;
 }
@@ -268,78 +552,253 @@ int Ex0days::startHMI()
 {
     _hmi->init(this);
     _hmi->show();
+    _recoverPreviousJob();
     return _app->exec();
 }
 
 void Ex0days::processFolders(const QStringList &srcFolders)
 {
+    if (!_startJob(srcFolders))
+        return;
+
+    if (_hmi)
+        _hmi->setProgressMax(0); // busy until we find the first folder
+    if (_debug)
+        _log(tr("Scanning the input folders..."));
+
+    _scanning = true;
+    emit scanFolders(++_scanId, srcFolders);
+}
+
+bool Ex0days::_startJob(const QStringList &roots)
+{
+    if (_jobRunning)
+    {
+        _error(tr("A job is already running"));
+        return false;
+    }
+
+    // a scan still running (stopped job) reads the index that is reloaded below
+    _scanner->stop(_scanId);
+    _scanner->waitScanDone();
+
     _nbFailed    = 0;
+    _nbProcessed = 0;
+    _nbRunning   = 0;
+    _nbExtraProcs = 0;
+    _threadsUsed = 0;
+    _nbFolders   = 0;
+    _nbSkipped   = 0;
+    _bytesTotal  = 0;
+    _bytesDone   = 0;
     _stopProcess = false;
+    _draining    = false;
+    _foldersToExtract.clear();
+    _queuedPaths.clear();
+    _runStats.clear();
+    QString date = QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss");
     _logFile = new QFile(QString("./%1/%2_%3.csv").arg(
                              sLogFolder).arg(
                              appName()).arg(
-                             QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss")));
+                             date));
     if (_logFile->open(QIODevice::WriteOnly|QIODevice::Text))
         _logStream.setDevice(_logFile);
     else
     {
         _error("Issue creating log file...");
-        return;
+        delete _logFile;
+        _logFile = nullptr;
+        return false;
+    }
+    _reportFile = new QFile(QString("./%1/%2_%3.jsonl").arg(sLogFolder).arg(appName()).arg(date));
+    if (!_reportFile->open(QIODevice::WriteOnly|QIODevice::Text))
+    {
+        _error(tr("Issue creating the report file: %1").arg(_reportFile->errorString()));
+        delete _reportFile;
+        _reportFile = nullptr; // not worth stopping the job
     }
 
     _timeStart.start();
 
-    for (const QString &srcFolder : srcFolders)
+    _index->load(_testOnly, !_force); // before the scan as the scanner reads it
+    _extractPool.setMaxThreadCount(_procBudget());
+    _stagingUsed     = 0;
+    _dstReserved     = 0;
+    _waitingForSpace = false;
+    _devices.reset();
+    _dstDevice = DeviceScheduler::deviceOf(_dstDir->absolutePath());
+    if (_debug && _dstDevice)
+        _log(tr("Output on device %1 (%2)").arg(DeviceScheduler::deviceName(_dstDevice)).arg(
+                 _devices.isRotational(_dstDevice) ? "HDD" : "SSD"));
+    if (_adaptive)
+        _jobController.start(1, _nbJobs, _timeStart.elapsed());
+    _createWorkers();
+    _journal->startJob(roots);
+    _jobRunning = true;
+    return true;
+}
+
+bool Ex0days::_queueFolder(const FolderEntry &entry)
+{
+    QString key = entry.path.join("/");
+    if (_queuedPaths.contains(key))
+        return false;
+
+    _queuedPaths.insert(key);
+    _journal->queued(entry.path); // before any worker touches it
+    if (_order == ORDER::FIFO)
+        _foldersToExtract.enqueue(entry);
+    else
     {
-        QFileInfo fi(srcFolder);
-        _browseDir(srcFolder, {fi.path(), fi.fileName()});
+        // after the ones that go before or are equivalent (FIFO between them)
+        auto comesFirst = [this](const FolderEntry &lhs, const FolderEntry &rhs) {
+            switch (_order) {
+            case ORDER::LARGEST:
+                return lhs.unzippedSize > rhs.unzippedSize;
+            case ORDER::SMALLEST:
+                return lhs.unzippedSize < rhs.unzippedSize;
+            default:
+                return lhs.lastModified > rhs.lastModified;
+            }
+        };
+        auto it = std::upper_bound(_foldersToExtract.begin(), _foldersToExtract.end(), entry, comesFirst);
+        _foldersToExtract.insert(it, entry);
     }
+    _bytesTotal += entry.unzippedSize;
+    ++_nbFolders;
+    if (_hmi)
+        _hmi->updateProgressMax(static_cast<int>(_nbFolders));
+    return true;
+}
 
-#ifdef __DEBUG__
-    for (const auto & folder : _foldersToExtract)
-        qDebug() << "0day folder: " << folder.join("/");
-#endif
+FolderJournal::Recovery Ex0days::_recoverPreviousJob()
+{
+    if (!_journal->lock())
+        _error(tr("Another %1 is running in this folder: no recovery of its journal and no journal for this run").arg(appName()));
+    FolderJournal::Recovery recovery = _journal->recover();
+    if (recovery.nbRolledBack)
+        _log(tr("The previous job has been interrupted: %1 folders rolled back").arg(recovery.nbRolledBack));
+    if (recovery.nbCleaned)
+        _log(tr("The previous job has been interrupted: cleaning of %1 extracted folders finished").arg(recovery.nbCleaned));
+    if (!recovery.roots.isEmpty())
+        _log(tr("%1 folders of the previous job were not processed (cf --%2)").arg(
+                 recovery.folders.size()).arg(sOptionNames[Opt::RESUME]));
+    return recovery;
+}
 
-    _log(tr("<b>There are %1 0days folders to process</b>").arg(_foldersToExtract.size()));
-    if (_hmi)
+void Ex0days::_resumeJob(const FolderJournal::Recovery &recovery)
+{
+    if (!_startJob(recovery.roots))
+        return;
+
+    for (const QStringList &folderPath : recovery.folders)
+        _queueFolder(FolderScanner::indexFolder(folderPath));
+    _log(tr("<b>Resuming the previous job with %1 0days folders</b>").arg(_nbFolders));
+
+    if (recovery.scanned)
+        _journal->scanDone();
+    else
     {
-        _folderIdx = 0;
-        _hmi->setProgressMax(_foldersToExtract.size());
+        // the scan hadn't finished: the folders we already have are ignored
+        _scanning = true;
+        emit scanFolders(++_scanId, recovery.roots);
     }
+    onProcessNextFolder();
+}
 
-    emit processNextFolder();
+void Ex0days::_startWatching(const QStringList &srcFolders, int intervalSec)
+{
+    _log(tr("Watching the input folders (interval: %1 sec)").arg(intervalSec));
+    _index->load(_testOnly, !_force); // the scans skip what has already been done
+    _watcher = new FolderWatcher(this);
+    connect(_watcher, &FolderWatcher::scanNeeded, this, &Ex0days::onWatchScan);
+    _watcher->start(srcFolders, intervalSec);
 }
 
-void Ex0days::stopProcessing()
+void Ex0days::onWatchScan()
 {
-    _stopProcess = true;
-    if (_extProc.state()!= QProcess::NotRunning)
-        _extProc.terminate();
-    if (_hmi)
+    if (_scanning || _jobRunning)
+        return; // the next notification or poll will do
+
+    _watchScan = true;
+    _scanning  = true;
+    emit scanFolders(++_scanId, _watcher->roots(), true);
+}
+
+void Ex0days::_processWatchedFolders(const QList<FolderEntry> &folders)
+{
+    if (!_startJob(_watcher->roots()))
+        return; // we'll try again with the next folders
+
+    for (const FolderEntry &entry : folders)
+        _queueFolder(entry);
+    _journal->scanDone();
+    _log(tr("<b>%1 new 0days folders to process</b>").arg(_nbFolders));
+    onProcessNextFolder();
+}
+
+void Ex0days::onFolderFound(int scanId, const FolderEntry &entry)
+{
+    if (scanId != _scanId || _stopProcess || _draining)
+        return;
+
+    if (_watchScan)
     {
-        _error(tr("Job stopped with %1 0days extracted").arg(_folderIdx-1));
-        _hmi->setIDLE();
+        _watcher->addCandidate(entry); // processed once its zips are stable
+        return;
     }
+
+    if (_queueFolder(entry))
+        onProcessNextFolder();
 }
 
-void Ex0days::_browseDir(const QString &folderPath, const QStringList &parents)
+void Ex0days::onFolderSkipped(int scanId, const QString &folderPath)
 {
-    QDir dir(folderPath);
-    QFileInfoList subFolders = dir.entryInfoList(QDir::AllDirs|QDir::Hidden|QDir::NoDotAndDotDot|QDir::NoSymLinks,  QDir::Name);
-    if (subFolders.isEmpty())
+    if (scanId != _scanId || _stopProcess || _watchScan)
+        return;
+
+    ++_nbSkipped;
+    if (_debug)
+        _log(tr("%1 skipped (unchanged since its last success)").arg(folderPath));
+}
+
+void Ex0days::onScanDone(int scanId)
+{
+    if (scanId != _scanId)
+        return;
+
+    _scanning = false;
+    if (_watchScan)
     {
-//        qDebug() << "0day folder: " << dir.absolutePath();
-        _foldersToExtract << parents;
+        _watchScan = false;
+        QList<FolderEntry> readyFolders = _watcher->takeReadyFolders();
+        if (!readyFolders.isEmpty())
+            _processWatchedFolders(readyFolders);
+        return;
     }
+    if (_stopProcess || _draining)
+        return; // the job has already been closed (or will be without the rest of the folders)
+
+    _journal->scanDone();
+    if (_nbSkipped)
+        _log(tr("<b>There are %1 0days folders to process (%2 unchanged ones skipped)</b>").arg(_nbFolders).arg(_nbSkipped));
     else
+        _log(tr("<b>There are %1 0days folders to process</b>").arg(_nbFolders));
+    onProcessNextFolder();
+}
+
+void Ex0days::stopProcessing()
+{
+    _stopProcess = true;
+    _scanner->stop(_scanId);
+    for (FolderWorker *worker : _workers)
+        worker->stop();
+    if (_hmi)
     {
-        for (const QFileInfo &subFolder : subFolders)
-        {
-            QStringList newParents(parents);
-            newParents << subFolder.fileName();
-            _browseDir(subFolder.absoluteFilePath(), newParents);
-        }
+        _error(tr("Job stopped with %1 0days extracted").arg(_nbProcessed));
+        _hmi->setIDLE();
     }
+    emit processNextFolder(); // to close the job if no folder is running
 }
 
 void Ex0days::_log(const QString &msg, bool success)
@@ -362,27 +821,90 @@ void Ex0days::_error(const QString &msg)
         _hmi->error(msg);
 }
 
-void Ex0days::_failExtract(const QString &reason)
+void Ex0days::_failExtract(const QString &folderPath, const QString &reason)
 {
     ++_nbFailed;
-    _logStream << _srcDir->absolutePath() << ", " << reason << "\n" << flush;
-    _error(tr("%1 KO (%2)").arg(_srcDir->absolutePath()).arg(reason));
+    _logStream << folderPath << ", " << reason << "\n" << flush;
+    _error(tr("%1 KO (%2)").arg(folderPath).arg(reason));
 }
 
-void Ex0days::_clearDir()
+void Ex0days::_writeReport(const FolderReport &report)
 {
-    _state = STATE::IDLE;
-    if (_srcDir)
+    if (_reportFile)
     {
-        delete _srcDir;
-        _srcDir = nullptr;
+        _reportFile->write(report.toJsonLine());
+        _reportFile->write("\n");
+        _reportFile->flush(); // readable while the job runs
     }
-    _zipFiles.clear();
-    _currentPath.clear();
-    _currentZip = QFileInfo();
-    _unzippedFiles.clear();
+    if (_trace)
+        report.trace(*_trace);
+    _runStats.add(report);
 }
 
+void Ex0days::_createWorkers()
+{
+    _deleteWorkers();
+    for (int i = 0 ; i < _nbJobs ; ++i)
+    {
+        FolderWorker *worker = new FolderWorker(*this, i);
+        // queued so the worker is fully idle before we give it another folder
+        connect(worker, &FolderWorker::folderDone,    this, &Ex0days::onFolderDone,    Qt::QueuedConnection);
+        connect(worker, &FolderWorker::folderStopped, this, &Ex0days::onFolderStopped, Qt::QueuedConnection);
+        connect(this,   &Ex0days::procSlotReleased,   worker, &FolderWorker::onUnzipNextFile, Qt::QueuedConnection);
+        _workers << worker;
+    }
+}
+
+Extractor *Ex0days::_newExtractor(ARCHIVE_TYPE type, QObject *parent, bool inMemory)
+{
+#ifdef __USE_LIBARCHIVE__
+    if (inMemory || _inProcTypes.contains(type))
+        return new LibArchiveExtractor(*this, inMemory, parent);
+#else
+    Q_UNUSED(type)
+    Q_UNUSED(inMemory)
+#endif
+    return new ProcessExtractor(*this, parent);
+}
+
+bool Ex0days::_setInProcTypes(const QString &types)
+{
+#ifdef __USE_LIBARCHIVE__
+    _inProcTypes.clear();
+    for (const QString &type : types.toLower().split(","))
+    {
+        QString name = type.trimmed();
+        if (name.isEmpty())
+            continue;
+        else if (name == "zip")
+            _inProcTypes << ARCHIVE_TYPE::ZIP;
+        else if (name == "rar")
+            _inProcTypes << ARCHIVE_TYPE::RAR;
+        else if (name == "7z")
+            _inProcTypes << ARCHIVE_TYPE::Z7;
+        else
+        {
+            _error(tr("libarchive can only extract zip, rar and 7z archives (not %1)").arg(name));
+            return false;
+        }
+        _log(tr("Extracting %1 archives in process").arg(archiveTypeName(_inProcTypes.last())));
+    }
+    return true;
+#else
+    Q_UNUSED(types)
+    _error(tr("--%1 is not available: %2 has been built without libarchive").arg(
+               sOptionNames[Opt::INPROC]).arg(sAppName));
+    return false;
+#endif
+}
+
+void Ex0days::_deleteWorkers()
+{
+    qDeleteAll(_workers);
+    _workers.clear();
+}
+
+
 void Ex0days::_clearLogFile()
 {
     if (_logFile)
@@ -394,170 +916,304 @@ void Ex0days::_clearLogFile()
         delete _logFile;
         _logFile = nullptr;
     }
+    if (_reportFile)
+    {
+        _reportFile->close();
+        if (_reportFile->size() == 0)
+            _reportFile->remove();
+        delete _reportFile;
+        _reportFile = nullptr;
+    }
 }
 
 void Ex0days::onProcessNextFolder()
 {
-    if (_hmi)
-        _hmi->setProgress(_folderIdx++);
-
-    _clearDir();
-    if (_stopProcess || _foldersToExtract.isEmpty())
+    if (!_stopProcess && !_draining)
     {
-        _clearLogFile();
-        _logTimeElapsed();
-        if (_hmi)
+        for (FolderWorker *worker : _workers)
         {
-            _hmi->setProgress(_folderIdx);
-            _hmi->setIDLE();
-        }
-        else
-            qApp->quit();
-    }
-    else
-    {
-        _currentPath = _foldersToExtract.dequeue();
-        _srcDir  = new QDir(_currentPath.join("/"));
-        QFileInfoList files = _srcDir->entryInfoList(QDir::Files|QDir::Hidden|QDir::Readable|QDir::NoSymLinks, QDir::Name);
-        if (files.isEmpty())
-        {
-            _failExtract(tr("empty folder"));
-            _goToNextFolder(false);
-        }
-        else
-        {
-            qDebug() << tr("%1 ===>").arg(_srcDir->absolutePath());
-            QFileInfoList zips;
-            for (const QFileInfo &fi : files)
+            if (_foldersToExtract.isEmpty() || _nbRunning >= _activeJobs())
+                break;
+            if (worker->isIdle())
             {
-                if  (fi.suffix().toLower() == "zip")
-                    zips << fi;
-            }
-
-            if (zips.isEmpty())
-            {
-                _failExtract(tr("no zip files"));
-                _goToNextFolder(false);
-            }
-            else
-            {
-                // Copy all zip in dest folder
-                if (_debug)
-                    _log(tr("Processing %1 (%2 zips)").arg(_srcDir->absolutePath()).arg(zips.size()));
-                QString subPath = _subPath();
-                if (!_dstDir->mkpath(subPath))
-                    qCritical() << "Error creating folder: " << _dstDir->absolutePath() << "/" << subPath;
-                for (const QFileInfo &fi : zips)
-                {
-                    QFileInfo copy(QString("%1/%2/%3").arg(
-                                       _dstDir->absolutePath()).arg(
-                                       subPath).arg(
-                                       fi.fileName()));
-                    if (QFile::copy(fi.absoluteFilePath(), copy.absoluteFilePath()))
-                        _zipFiles << copy;
-                    else
-                        qCritical() << "Error copying file: " << fi.absoluteFilePath()
-                                    << " to " << copy.absoluteFilePath();
-                }
-
-                _state = STATE::UNZIP;
-                _extProc.setWorkingDirectory(QString("%1/%2").arg(_dstDir->absolutePath()).arg(subPath));
-                onUnzipNextFile();
+                qint64 footprint = 0, stagingSize = 0;
+                int index = _admitNextFolder(footprint, stagingSize);
+                if (index < 0)
+                    break;
+                ++_nbRunning;
+                worker->processFolder(_foldersToExtract.takeAt(index), footprint, stagingSize);
             }
         }
     }
+
+    if ((_stopProcess || _draining || (!_scanning && _foldersToExtract.isEmpty())) && _nbRunning == 0)
+        _finishProcessing();
+    else if (_foldersToExtract.isEmpty() && _unzipJobs > 1 && _nbRunning + _nbExtraProcs < _procBudget())
+        emit procSlotReleased(); // the slot of the folder can be used to unzip in parallel
 }
 
-void Ex0days::onUnzipNextFile()
+bool Ex0days::_acquireProcSlot()
 {
-    if (_zipFiles.isEmpty())
-        _doSecondExtract();
-    else
-    {
-        _currentZip = _zipFiles.dequeue();
+    // each running folder holds one process slot, the extra unzips share the rest
+    if (_nbRunning + _nbExtraProcs >= _procBudget())
+        return false;
 
-        QStringList args = s7zArgs;
-        args << _currentZip.fileName(); // the process is in the good directory!
+    ++_nbExtraProcs;
+    return true;
+}
 
-        qDebug() << _7zCmd << " "  << args.join(" ");
-        _extProc.start(_7zCmd, args);
-    }
+void Ex0days::_releaseProcSlot()
+{
+    --_nbExtraProcs;
+    emit procSlotReleased();
 }
 
-void Ex0days::onAbout()
+int Ex0days::_acquireThreads()
 {
-    About about(this);
-    about.exec();
+    // fair share between the extractions that can run at once:
+    // a single big folder gets all the cores, many small ones one each
+    int budget     = _threadBudgetSize();
+    int concurrent = _nbRunning + _nbExtraProcs;
+    if (!_foldersToExtract.isEmpty())
+        concurrent = qMax(concurrent, _activeJobs()); // the idle workers will get a folder soon
+    int nbThreads = qBound(1, budget / qMax(1, concurrent), qMax(1, budget - _threadsUsed));
+    _threadsUsed += nbThreads;
+    return nbThreads;
 }
 
+void Ex0days::_releaseThreads(int nbThreads)
+{
+    _threadsUsed = qMax(0, _threadsUsed - nbThreads);
+}
 
-void Ex0days::onDonate()
+bool Ex0days::_reserveStaging(qint64 size)
 {
-    QDesktopServices::openUrl(sDonationURL);
+    if (_stagingBudget > 0 && _stagingUsed + size > _stagingBudget)
+        return false;
+    if (!_hasFreeSpace(_stagingPath, _stagingFree, _stagingUsed, size))
+        return false;
+
+    _stagingUsed += size;
+    return true;
 }
 
-void Ex0days::onProcFinished(int exitCode)
+void Ex0days::_releaseStaging(qint64 size)
 {
-    if (_stopProcess)
+    _stagingUsed -= size;
+}
+
+bool Ex0days::_reserveDst(qint64 size)
+{
+    if (!_hasFreeSpace(_dstDir->absolutePath(), _dstFree, _dstReserved, size))
+        return false;
+
+    _dstReserved += size;
+    return true;
+}
+
+void Ex0days::_releaseDst(qint64 size, qint64 keptSize)
+{
+    _dstReserved -= size;
+    _dstFree     -= keptSize;
+}
+
+bool Ex0days::_hasFreeSpace(const QString &path, qint64 &freeSpace, qint64 reserved, qint64 size)
+{
+    // the free space is only read when nothing is reserved: with running folders, what they've
+    // already written would be counted twice (in the live value and in their reservations)
+    if (reserved == 0)
     {
-        --_folderIdx;
-        onProcessNextFolder();
+        QStorageInfo storage(path); // statvfs
+        freeSpace = storage.isValid() ? storage.bytesAvailable() : -1;
+    }
+    return freeSpace < 0 || freeSpace - reserved - size >= _headroom;
+}
+
+bool Ex0days::_reserveFolder(const FolderEntry &entry, qint64 &footprint, qint64 &stagingSize)
+{
+    // peak of a folder in the output: copies of the zips, unzipped volumes then the payload
+    // (the second archive is considered as big as what it extracts)
+    // where the volumes go is decided here once: the worker doesn't fall back on the output
+    footprint   = _testOnly ? 0 : entry.unzippedSize;
+    stagingSize = 0;
+    if (!_stream || entry.unzippedSize > sMaxStreamSize)
+    {
+        qint64 volumes = (_staging == STAGING::NO_COPY ? 0 : entry.zipsSize) + entry.unzippedSize;
+        if (!_stagingPath.isEmpty() && _reserveStaging(volumes))
+            stagingSize = volumes;
+        else
+            footprint += (_staging == STAGING::COPY ? entry.zipsSize : 0) + entry.unzippedSize; // a move is a rename
     }
-    else if (_state == STATE::UNZIP)
+
+    if (_reserveDst(footprint))
+        return true;
+
+    if (stagingSize)
     {
-        qDebug() << "Zip extracted: "<< _currentZip.absoluteFilePath() << " : " << exitCode;
-        if (exitCode != 0)
+        _releaseStaging(stagingSize);
+        stagingSize = 0;
+    }
+    return false;
+}
+
+QList<quint64> Ex0days::_folderDevices(const FolderEntry &entry) const
+{
+    QList<quint64> devices;
+    if (entry.device)
+        devices << entry.device;
+    if (_dstDevice && _dstDevice != entry.device)
+        devices << _dstDevice;
+    return devices;
+}
+
+int Ex0days::_admitNextFolder(qint64 &footprint, qint64 &stagingSize)
+{
+    for (int i = 0; i < _foldersToExtract.size(); )
+    {
+        // the first one (in --order) whose devices aren't busy: the devices are interleaved
+        const FolderEntry &entry = _foldersToExtract.at(i);
+        QList<quint64> devices = _folderDevices(entry);
+        if (!_devices.canStart(devices))
         {
-            _failExtract(tr("error #%1 on zip file: %2").arg(exitCode).arg(_currentZip.fileName()));
-            _goToNextFolder(false);
+            ++i;
+            continue;
         }
-        else
+
+        if (_reserveFolder(entry, footprint, stagingSize))
         {
-            QFile file(_currentZip.absoluteFilePath());
-            if (!file.remove())
-            {
-                qCritical() << "Error deleting " << _currentZip.absoluteFilePath() << ": " << file.errorString();
-            }
-            emit unzipNext();
+            _waitingForSpace = false;
+            _devices.acquire(devices);
+            return i;
         }
-    }
-    else if (_state == STATE::FINAL)
-    {
-        bool success = exitCode == 0;
-        if (success)
-            _log(tr("%1 OK").arg(_srcDir->absolutePath()), true);
-        else
-            _failExtract(tr("error #%1 extracting archive: %2").arg(exitCode).arg(_fistArchive.fileName()));
 
-        _goToNextFolder(success);
+        if (_nbRunning > 0)
+        {
+            // held back until a running folder releases its space
+            if (!_waitingForSpace && _debug)
+                _log(tr("Waiting for free space in the output (%1 MB needed)").arg(footprint / 1024 / 1024));
+            _waitingForSpace = true;
+            return -1;
+        }
+
+        // nothing will release any space
+        QString folderPath = entry.path.join("/");
+        QString reason = tr("not enough free space in the output (%1 MB needed)").arg(footprint / 1024 / 1024);
+        _failExtract(folderPath, reason);
+        FolderReport report;
+        report.start(entry, -1);
+        report.setReason(reason);
+        report.finish(false, 0);
+        _writeReport(report);
+        // recorded as a failed folder like the workers do (otherwise the journal and the watcher would queue it again)
+        _index->record(folderPath, entry.isIndexed() ? entry.signature : FolderScanner::indexFolder(entry.path).signature, false);
+        _journal->setState(folderPath, FolderJournal::STATE::CLEANED);
+        ++_nbProcessed;
+        _bytesDone += entry.unzippedSize;
+        if (_hmi)
+            _hmi->setProgress(static_cast<int>(_nbProcessed));
+        _foldersToExtract.removeAt(i);
     }
+    return -1;
 }
 
-void Ex0days::_goToNextFolder(bool success, bool delUnzippedFiles)
+void Ex0days::onFolderDone(bool success, qint64 unzippedSize)
 {
-    if (_testOnly || !success)
+    Q_UNUSED(success)
+    --_nbRunning;
+    ++_nbProcessed;
+    _bytesDone += unzippedSize;
+    if (_hmi)
+        _hmi->setProgress(static_cast<int>(_nbProcessed));
+    else
+        _logProgress();
+    if (_adaptive)
+        _adaptJobs();
+
+    onProcessNextFolder();
+}
+
+void Ex0days::_adaptJobs()
+{
+    int previous = _jobController.limit();
+    QString reason;
+    if (_jobController.sample(_bytesDone, _nbProcessed, _timeStart.elapsed(), !_foldersToExtract.isEmpty(), reason))
+        _log(tr("Adaptive jobs: %1 -> %2 folders in parallel (%3)").arg(previous).arg(_jobController.limit()).arg(reason));
+    else if (_debug && !reason.isEmpty())
+        _log(tr("Adaptive jobs: staying at %1 folders in parallel (%2)").arg(previous).arg(reason));
+}
+
+void Ex0days::onFolderStopped()
+{
+    --_nbRunning;
+    onProcessNextFolder();
+}
+
+void Ex0days::onShutdownCheck()
+{
+    if (sShutdownRequests == _shutdownHandled)
+        return;
+
+    _shutdownHandled = sShutdownRequests;
+    if (!_jobRunning)
     {
-        QDir copyDir(QString("%1/%2").arg(_dstDir->absolutePath()).arg(_subPath()));
-        if (!copyDir.removeRecursively())
-            _error(tr("Error deleting copy directory: %1").arg(copyDir.absolutePath()));
-        else if (_debug)
-            _log(tr("Copy directory deleted: %1").arg(copyDir.absolutePath()));
+        _log(tr("Closing the application..."));
+        qApp->quit();
     }
-    else if (delUnzippedFiles)
+    else if (!_draining)
     {
-        for (const QFileInfo & fi : _unzippedFiles)
-            QFile::remove(fi.absoluteFilePath());
+        _log(tr("Closing the application once the running folders are done (send the signal again to abort them)"));
+        _draining = true;
+        _scanner->stop(_scanId); // no watch scan either as the job is still running
+        emit processNextFolder(); // to close the job if no folder is running
     }
+    else if (!_stopProcess)
+    {
+        _log(tr("Aborting the running folders..."));
+        stopProcessing(); // their outputs are rolled back
+    }
+}
 
-    if (_delSrc)
+void Ex0days::_finishProcessing()
+{
+    if (!_jobRunning)
+        return; // already done (stopped job whose scan or workers are reporting late)
+
+    _jobRunning = false;
+    if (!_stopProcess && !_draining)
+        _journal->endJob();
+    else if (_nbFolders > _nbProcessed)
+        _log(tr("%1 folders left, use --%2 to process them").arg(_nbFolders - _nbProcessed).arg(sOptionNames[Opt::RESUME]));
+    _logRunStats(); // before the report is closed
+    _clearLogFile();
+    _index->close();
+    _logTimeElapsed();
+    if (sShutdownRequests)
+        qApp->quit();
+    else if (_hmi)
     {
-        if (!_srcDir->removeRecursively())
-            _error(tr("Error deleting source directory: %1").arg(_srcDir->absolutePath()));
-        else if (_debug)
-            _log(tr("Source directory deleted: %1").arg(_srcDir->absolutePath()));
+        _hmi->setProgress(static_cast<int>(_nbProcessed));
+        _hmi->setIDLE();
+    }
+    else if (_watcher && !_stopProcess)
+    {
+        if (_nbFailed)
+            _log(tr("%1 folders KO, cf the csv in %2").arg(_nbFailed).arg(sLogFolder));
+        _index->load(_testOnly, !_force); // with the results of this job for the next scans
     }
+    else
+        qApp->quit();
+}
+
+void Ex0days::onAbout()
+{
+    About about(this);
+    about.exec();
+}
 
-    emit processNextFolder();
+
+void Ex0days::onDonate()
+{
+    QDesktopServices::openUrl(sDonationURL);
 }
 
 void Ex0days::_syntax(char *appName)
@@ -575,52 +1231,35 @@ void Ex0days::_syntax(char *appName)
     _cout << "\n" << flush;
 }
 
-void Ex0days::_doSecondExtract()
+void Ex0days::_logProgress()
 {
-    _state = STATE::FINAL;
-    qDebug() << tr("Ready for Second Extract!");
-
-    QDir copyDir(QString("%1/%2").arg(_dstDir->absolutePath()).arg(_subPath()));
-    _unzippedFiles = copyDir.entryInfoList(QDir::Files|QDir::Hidden|QDir::Readable|QDir::NoSymLinks, QDir::Name);
-    bool isFirstArchive = false, allUnknowArchives = true;
-    for (const QFileInfo &file : _unzippedFiles)
-    {
-        _findArchiveType(file, isFirstArchive);
-        if (_archiveType != ARCHIVE_TYPE::UNKNOWN)
-            allUnknowArchives = false;
-
-        if (isFirstArchive)
-        {
-            _fistArchive = file;
-            break;
-        }
-    }
-
-    if (isFirstArchive)
-    {
-        if (_debug)
-            _log(tr("  - first archive found: %1").arg(_fistArchive.fileName()));
-        const QString &cmd = _extractCMD();
-        QStringList   args = s7zArgs;
-        if (_archiveType == ARCHIVE_TYPE::ARJ)
-            args << "-v"; // multi-volume
-        else if (_useWinrar && _archiveType == ARCHIVE_TYPE::RAR)
-            args << "-ibck";
+    if (_bytesTotal == 0 || _bytesDone == 0)
+        return; // nothing indexed
+
+    // the ETA supposes the time is proportional to the unzipped size
+    qint64 elapsed = _timeStart.elapsed();
+    qint64 eta     = static_cast<qint64>(static_cast<double>(elapsed) * (_bytesTotal - _bytesDone) / _bytesDone);
+    _log(tr("[%1/%2] %3 / %4 MB (%5%), ETA: %6:%7%8").arg(
+             _nbProcessed).arg(_nbFolders).arg(
+             _bytesDone / 1024 / 1024).arg(_bytesTotal / 1024 / 1024).arg(
+             100 * _bytesDone / _bytesTotal).arg(
+             eta / 3600000, 2, 10, QChar('0')).arg(
+             QTime::fromMSecsSinceStartOfDay(static_cast<int>(eta % 3600000)).toString("mm:ss")).arg(
+             _scanning ? tr(" (still scanning)") : QString()));
+}
 
-        args << _fistArchive.fileName(); // the process is in the good directory!
+void Ex0days::_logRunStats()
+{
+    if (_runStats.isEmpty())
+        return;
 
-        qDebug() << cmd << " "  << args.join(" ");
-        _extProc.start(cmd, args);
-    }
-    else if (allUnknowArchives)
+    _log(tr("Performance by type of archive (ms, input KB/s):"));
+    for (const QString &line : _runStats.summary())
+        _log(line);
+    if (_reportFile)
     {
-        _error(tr("%1 ?? (no second archives found)").arg(_srcDir->absolutePath()));
-        _goToNextFolder(true, false);
-    }
-    else
-    {
-        _failExtract(tr("first archive is missing"));
-        _goToNextFolder(false);
+        _reportFile->write(_runStats.toJsonLine(_timeStart.elapsed()));
+        _reportFile->write("\n");
     }
 }
 
@@ -630,7 +1269,7 @@ void Ex0days::_logTimeElapsed()
     double sec = (double)duration/1000;
 
     _log(tr("<br/><b> => %1 folders extracted in %2 sec (%3)</b>").arg(
-             _folderIdx-1).arg(std::round(sec)).arg(QTime::fromMSecsSinceStartOfDay(duration).toString("hh:mm:ss.zzz")));
+             _nbProcessed).arg(std::round(sec)).arg(QTime::fromMSecsSinceStartOfDay(duration).toString("hh:mm:ss.zzz")));
 }
 
 
@@ -704,6 +1343,16 @@ bool Ex0days::setDstFolder(const QString &path)
         return false;
 }
 
+bool Ex0days::setNbJobs(int nbJobs)
+{
+    if (nbJobs < 1 || nbJobs > sMaxJobs)
+        return false;
+
+    _nbJobs = nbJobs;
+    _settings->setValue(sParamValues[Param::nbJobs], _nbJobs);
+    return true;
+}
+
 void Ex0days::setOptions(bool testOnly, bool delSrc, bool debug, bool dispPaths)
 {
     _testOnly  = testOnly;
@@ -722,96 +1371,6 @@ QString Ex0days::setting(Ex0days::Param param) const
 }
 
 
-void Ex0days::_findArchiveType(const QFileInfo &file, bool &firstArchive)
-{
-    _archiveType = ARCHIVE_TYPE::UNKNOWN;
-    QString fileNameLowerCase = file.fileName().toLower();
-
-    QRegularExpressionMatch match = sRegExpArchiveExtensions.match(fileNameLowerCase);
-    if (match.hasMatch())
-    {
-        firstArchive = true;
-        QString ext = match.captured(1);
-        if (ext == "rar")
-            _archiveType = ARCHIVE_TYPE::RAR;
-        else if (ext == "ace")
-            _archiveType = ARCHIVE_TYPE::ACE;
-        else if (ext == "7z")
-            _archiveType = ARCHIVE_TYPE::Z7;
-        else
-            _archiveType = ARCHIVE_TYPE::ARJ;
-    }
-
-    if (_archiveType == ARCHIVE_TYPE::UNKNOWN || _archiveType == ARCHIVE_TYPE::RAR)
-    {
-        match = sRegExpArchiveFiles.match(fileNameLowerCase);
-        if (match.hasMatch())
-        {
-            QString baseName       = match.captured(1);
-            QString newRar         = match.captured(2);
-            QString number         = match.captured(3);
-            QString oldStyleLetter = match.captured(4);
-            QString rarExtenstion  = match.captured(5);
-
-            if (!newRar.isEmpty())
-                _archiveType = ARCHIVE_TYPE::RAR;
-            else if (baseName.endsWith(".7z"))
-                _archiveType = ARCHIVE_TYPE::Z7;
-            else if (!oldStyleLetter.isEmpty())
-            {
-                const QChar &letter = oldStyleLetter.at(0);
-                if (letter == 'r')
-                    _archiveType = ARCHIVE_TYPE::RAR;
-                else if (letter == 'a')
-                    _archiveType = ARCHIVE_TYPE::ARJ;
-                else
-                    _archiveType = ARCHIVE_TYPE::ACE;
-            }
-            else if (!number.isEmpty())
-                _archiveType = ARCHIVE_TYPE::RAR;
-
-            if (_archiveType == ARCHIVE_TYPE::RAR || _archiveType == ARCHIVE_TYPE::Z7)
-            {
-                if (!rarExtenstion.isEmpty() && newRar.isEmpty())
-                    firstArchive = true;
-                else
-                {
-                    if (sRegExpNumberOne.match(number).hasMatch())
-                        firstArchive = true;
-                    else
-                        firstArchive = false;
-                }
-            }            
-
-//            qDebug() << file << " matches with newRar: " << newRar
-//                     << ", number: " << number << ", oldStyleLetter: " << oldStyleLetter
-//                     << ", rarExtenstion: " << rarExtenstion;
-        }
-    }
-
-#ifdef __DEBUG__
-    QString archiveType;
-    switch (_archiveType) {
-    case ARCHIVE_TYPE::RAR:
-        archiveType = "RAR";
-        break;
-    case ARCHIVE_TYPE::ACE:
-        archiveType = "ACE";
-        break;
-    case ARCHIVE_TYPE::ARJ:
-        archiveType = "ARJ";
-        break;
-    case ARCHIVE_TYPE::Z7:
-        archiveType = "7Z";
-        break;
-    default:
-        archiveType = "UNKNOWN";
-        break;
-    }
-    qDebug() << file << " is " << archiveType << " (first: " << firstArchive << ")";
-#endif
-}
-
 void Ex0days::_loadSettings()
 {
     if (!QFileInfo(sLogFolder).exists())
@@ -840,6 +1399,10 @@ void Ex0days::_loadSettings()
         _testOnly = _settings->value(sParamValues[Param::testOnly]).toBool();
         _delSrc   = _settings->value(sParamValues[Param::delSrc]).toBool();
         _debug    = _settings->value(sParamValues[Param::debug]).toBool();
+
+        int nbJobs = _settings->value(sParamValues[Param::nbJobs], 1).toInt();
+        if (nbJobs >= 1 && nbJobs <= sMaxJobs)
+            _nbJobs = nbJobs;
     }
 }
 
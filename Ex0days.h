@@ -28,27 +28,63 @@
 #include <QQueue>
 #include <QFileInfo>
 #include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <QSet>
+#include <csignal>
+#include "ArchiveType.h"
+#include "FolderJournal.h"
+#include "FolderEntry.h"
+#include "DeviceScheduler.h"
+#include "JobController.h"
+#include "RunStats.h"
 class QSettings;
 class MainWindow;
+class FolderWorker;
+class FolderScanner;
+class FolderIndex;
+class FolderReport;
+class ChromeTrace;
+class FolderWatcher;
+class Extractor;
 
 class Ex0days : public QObject, public CmdOrGuiApp
 {
     Q_OBJECT
+    friend class FolderWorker; //!< to access the settings, logs and counters
+    friend class ProcessExtractor;    //!< to access the commands
+    friend class LibArchiveExtractor; //!< to access the thread pool
+
 public:
     enum class Param {cmd7z, cmdRar, cmdAce, cmdArj, dstDir,
-                      testOnly, delSrc, debug, dispPaths};
+                      testOnly, delSrc, debug, dispPaths, nbJobs};
+
+    using ARCHIVE_TYPE = ::ARCHIVE_TYPE; //!< cf ArchiveType.h
 
 private:
     enum class Opt {HELP = 0, VERSION, DEBUG,
-                    INPUT, OUTPUT, TEST, DEL,
+                    INPUT, OUTPUT, TEST, DEL, JOBS,
+                    NO_COPY, IN_PLACE, HARDLINK, BATCH_UNZIP,
+                    UNZIP_JOBS, MAX_PROCS, INPROC, STREAM,
+                    STAGING_DIR, STAGING_BUDGET, HEADROOM, ORDER, HDD_JOBS, SSD_JOBS, ADAPTIVE, THREADS, TRACE,
+                    FORCE, WATCH, RESUME,
                     Z7, UNRAR, UNACE
                    };
-    enum class STATE : char {IDLE = 0, UNZIP, FINAL};
 
-    enum class ARCHIVE_TYPE {UNKNOWN = 0, RAR, ACE, ARJ, Z7};
+    //! how the zips are brought in the destination folder for the first extraction
+    enum class STAGING : char {COPY = 0, //!< copy of the zips in the destination (default)
+                               NO_COPY,  //!< unzip straight from the source folder
+                               MOVE      //!< rename the zips in the destination (only with --del)
+                              };
 
+    //! order of the folders waiting for a worker (cf --order)
+    enum class ORDER : char {FIFO = 0, //!< as they're found (default)
+                             LARGEST,  //!< biggest first: shortest makespan with several jobs
+                             SMALLEST, //!< quickest results
+                             NEWEST    //!< most recent zips first
+                            };
 
-    STATE               _state;
 
     QString             _7zCmd;
     QString             _unrarCmd;
@@ -59,16 +95,50 @@ private:
 
     QTextStream         _cout; //!< stream for stdout
     QTextStream         _cerr; //!< stream for stderr
-    QProcess            _extProc;
-    QQueue<QStringList> _foldersToExtract;
-    int                 _folderIdx;
-    QDir               *_srcDir;
-    QStringList         _currentPath;
-    QQueue<QFileInfo>   _zipFiles;
-    QFileInfo           _currentZip;
-    QFileInfo           _fistArchive;
-    ARCHIVE_TYPE        _archiveType;
-    QFileInfoList       _unzippedFiles;
+    QQueue<FolderEntry> _foldersToExtract;
+    QThread             _scanThread;  //!< thread of the _scanner
+    FolderScanner      *_scanner;     //!< producer of _foldersToExtract
+    FolderIndex        *_index;       //!< folders already processed by the previous runs
+    bool                _force;       //!< process the folders even if they're in the index
+    uint                _nbSkipped;   //!< unchanged folders skipped thanks to the index
+    FolderWatcher      *_watcher;     //!< daemon mode (--watch)
+    bool                _watchScan;   //!< the current scan looks for new folders (no job running)
+    bool                _jobRunning;
+    FolderJournal      *_journal;     //!< write-ahead journal of the current job (crash recovery, --resume)
+    QSet<QString>       _queuedPaths; //!< folders of the job already queued (a resumed job rescans them)
+    QTimer              _shutdownTimer;   //!< polls sShutdownRequests (set by the signal handler)
+    int                 _shutdownHandled; //!< number of signals already handled
+    bool                _draining;        //!< first signal: no new folder, the running ones finish
+    int                 _scanId;      //!< to ignore folders of a previous (stopped) scan
+    bool                _scanning;    //!< discovery still in progress
+    uint                _nbFolders;   //!< folders discovered so far
+    QList<FolderWorker*> _workers;   //!< one pipeline per concurrent folder
+    int                 _nbJobs;     //!< number of folders processed concurrently
+    bool                _adaptive;   //!< _nbJobs is only the upper bound of the JobController (--adaptive)
+    JobController       _jobController;
+    uint                _nbProcessed; //!< folders done (OK or KO)
+    qint64              _bytesTotal;  //!< unzipped size of the folders found so far (cf FolderEntry)
+    qint64              _bytesDone;   //!< unzipped size of the folders done
+    int                 _nbRunning;   //!< folders given to a worker and not done yet
+    int                 _unzipJobs;   //!< max number of 7z unzipping the same folder
+    int                 _maxProcs;    //!< global budget of extractor processes (0: auto)
+    int                 _nbExtraProcs; //!< processes running on top of the one of each folder
+    int                 _threadBudget; //!< cores shared by the extractor processes (--threads, 0: auto)
+    int                 _threadsUsed;  //!< threads given to the running extractor processes
+    QList<ARCHIVE_TYPE> _inProcTypes; //!< archive types extracted with libarchive (--inproc)
+    QThreadPool         _extractPool; //!< threads of the in-process extractions
+    bool                _stream;      //!< unzip in memory and extract the second stage from there
+    QString             _stagingPath;   //!< folder for the intermediate files (tmpfs...)
+    qint64              _stagingBudget; //!< bytes usable in _stagingPath (0: its free space)
+    qint64              _stagingUsed;   //!< bytes reserved by the running folders
+    qint64              _dstReserved;   //!< bytes reserved in the destination by the running folders
+    qint64              _stagingFree;   //!< free space of the staging filesystem when nothing was reserved (cf _hasFreeSpace)
+    qint64              _dstFree;       //!< same for the destination (minus what the finished folders have left)
+    qint64              _headroom;      //!< free space to keep on the destination and staging filesystems
+    bool                _waitingForSpace; //!< folders are held back until some space is released
+    ORDER               _order;
+    DeviceScheduler     _devices;       //!< folders running on each source / destination device
+    quint64             _dstDevice;
 
     QElapsedTimer       _timeStart;
 
@@ -77,10 +147,16 @@ private:
 
     bool                _testOnly;
     bool                _delSrc;
+    STAGING             _staging;
+    bool                _allowHardlink; //!< when copying the zips on the same device
+    bool                _batchUnzip;    //!< one single 7z to unzip all the zips of a folder
 
     bool                _debug;
     QFile              *_logFile;
     QTextStream         _logStream;
+    QFile              *_reportFile;  //!< JSON Lines, one FolderReport per folder
+    ChromeTrace        *_trace;       //!< timeline of the stages (--trace, nullptr otherwise)
+    RunStats            _runStats;    //!< histograms of the folders of the job
 
     bool                _useWinrar;
     uint                _nbFailed;
@@ -107,12 +183,14 @@ public:
     bool setDstFolder(const QString &path);
 
     void setOptions(bool testOnly, bool delSrc, bool debug, bool dispPaths);
+    bool setNbJobs(int nbJobs);
 
     QString setting(Param param) const;
 
     inline bool testOnly() const;
     inline bool delSrc() const;
     inline bool debug() const;
+    inline int  nbJobs() const;
     bool dispPaths() const;
 
     inline void setDebug(bool enable);
@@ -121,12 +199,18 @@ public:
 
 signals:
     void processNextFolder();
-    void unzipNext();
+    void procSlotReleased(); //!< a worker may launch another unzip
+    void scanFolders(int scanId, const QStringList &srcFolders, bool watchScan = false);
 
 public slots:
-    void onProcFinished(int exitCode);
+    void onFolderFound(int scanId, const FolderEntry &entry);
+    void onFolderSkipped(int scanId, const QString &folderPath);
+    void onWatchScan();
+    void onScanDone(int scanId);
     void onProcessNextFolder();
-    void onUnzipNextFile();
+    void onFolderDone(bool success, qint64 unzippedSize);
+    void onFolderStopped();
+    void onShutdownCheck();
 
     void onAbout();
     void onDonate();
@@ -134,24 +218,46 @@ public slots:
 
 
 private:
-    void _browseDir(const QString &folderPath, const QStringList &parents);
     void _log(const QString &msg, bool success = false);
     void _error(const QString &msg);
-    void _failExtract(const QString &reason);
-    void _clearDir();
+    void _failExtract(const QString &folderPath, const QString &reason);
+    void _writeReport(const FolderReport &report);
     void _clearLogFile();
-    void _doSecondExtract();
+    void _createWorkers();
+    void _deleteWorkers();
+    void _finishProcessing();
+    bool _startJob(const QStringList &roots);
+    bool _queueFolder(const FolderEntry &entry);
+    FolderJournal::Recovery _recoverPreviousJob();
+    void _resumeJob(const FolderJournal::Recovery &recovery);
+    void _startWatching(const QStringList &srcFolders, int intervalSec);
+    void _processWatchedFolders(const QList<FolderEntry> &folders);
+    Extractor *_newExtractor(ARCHIVE_TYPE type, QObject *parent, bool inMemory = false);
+    bool _setInProcTypes(const QString &types);
+
+    bool _acquireProcSlot();
+    void _releaseProcSlot();
+    inline int _procBudget() const;
+    inline int _threadBudgetSize() const;
+    int  _acquireThreads();
+    void _releaseThreads(int nbThreads);
+    bool _reserveStaging(qint64 size);
+    void _releaseStaging(qint64 size);
+    bool _reserveDst(qint64 size);
+    void _releaseDst(qint64 size, qint64 keptSize = 0); //!< keptSize: what the folder leaves in the output
+    bool _hasFreeSpace(const QString &path, qint64 &freeSpace, qint64 reserved, qint64 size);
+    bool _reserveFolder(const FolderEntry &entry, qint64 &footprint, qint64 &stagingSize);
+    int  _admitNextFolder(qint64 &footprint, qint64 &stagingSize);
+    QList<quint64> _folderDevices(const FolderEntry &entry) const;
 
-    inline QString _subPath() const;
     void _logTimeElapsed();
-
-    void _findArchiveType(const QFileInfo &file, bool &firstArchive);
-    inline const QString &_extractCMD() const;
+    void _logRunStats();
+    void _logProgress();
+    void _adaptJobs();
+    inline int _activeJobs() const;
 
     void _loadSettings();
 
-    void _goToNextFolder(bool success, bool delUnzippedFiles = true);
-
     inline void _showVersionASCII();
     void _syntax(char *appName);
 
@@ -167,24 +273,30 @@ private:
     static constexpr const char *sLogFolder = "./logs";
 
     static const QMap<Opt, QString> sOptionNames;
+    static const QMap<ORDER, QString> sOrderNames;
     static const QList<QCommandLineOption> sCmdOptions;
     static const QStringList s7zArgs;
+    static const QStringList s7zTestArgs; //!< test of the second archive (nothing written)
 
     static const QMap<Param, QString> sParamValues;
 
     static const QString sASCII;
 
-    static const QRegularExpression sRegExpArchiveExtensions;
-    static const QRegularExpression sRegExpArchiveFiles;
-    static const QRegularExpression sRegExpNumberOne;
-
     static const QString sDonationURL;
 
 
 public:
+    static constexpr int sMaxJobs = 64; //!< upper bound for --jobs
+    static volatile std::sig_atomic_t sShutdownRequests; //!< incremented by the SIGINT/SIGTERM handler only
+    static constexpr int sShutdownPollMs = 200;
+
+    static constexpr qint64 sDefaultHeadroom = 512; //!< MB (cf --headroom)
+    static constexpr qint64 sMaxStreamSize = 1024LL*1024*1024; //!< bigger folders are unzipped on disk (--stream)
+
     inline static QString desc(bool useHTML = false);
     inline static QString asciiArtWithVersion();
     inline static const QString &donationURL();
+    inline static QString archiveTypeName(ARCHIVE_TYPE type);
 
 };
 
@@ -193,30 +305,27 @@ const char *Ex0days::appName() { return sAppName; }
 bool Ex0days::testOnly() const { return _testOnly; }
 bool Ex0days::delSrc()   const { return _delSrc; }
 bool Ex0days::debug()    const { return _debug; }
+int  Ex0days::nbJobs()   const { return _nbJobs; }
 
 void Ex0days::setDebug(bool enable) { _debug = enable; }
 
 const QString &Ex0days::donationURL() { return sDonationURL; }
 
-QString Ex0days::_subPath() const
+int Ex0days::_activeJobs() const { return _adaptive ? _jobController.limit() : _nbJobs; }
+
+int Ex0days::_procBudget() const
+{
+    return _maxProcs > 0 ? _maxProcs : qMax(_nbJobs, QThread::idealThreadCount());
+}
+
+int Ex0days::_threadBudgetSize() const
 {
-    QStringList subPath(_currentPath);
-    subPath.removeFirst();
-    return subPath.join("/");
+    return _threadBudget > 0 ? _threadBudget : QThread::idealThreadCount();
 }
 
-const QString &Ex0days::_extractCMD() const
-{    
-    switch (_archiveType) {
-    case ARCHIVE_TYPE::ACE:
-        return _unaceCmd;
-    case ARCHIVE_TYPE::RAR:
-        return _unrarCmd.isEmpty() ? _7zCmd : _unrarCmd;
-    case ARCHIVE_TYPE::ARJ:
-        return _arjCmd;
-    default:
-        return _7zCmd;
-    }
+QString Ex0days::archiveTypeName(ARCHIVE_TYPE type)
+{
+    return ::archiveTypeName(type);
 }
 
 void Ex0days::_showVersionASCII()
@@ -38,18 +38,60 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += \
     About.cpp \
+    ArchiveDetector.cpp \
+    ChromeTrace.cpp \
     CmdOrGuiApp.cpp \
+    DeviceScheduler.cpp \
     Ex0days.cpp \
+    Extractor.cpp \
+    FileCopier.cpp \
+    FolderIndex.cpp \
+    FolderJournal.cpp \
+    FolderReport.cpp \
+    FolderScanner.cpp \
+    FolderWatcher.cpp \
+    FolderWorker.cpp \
+    JobController.cpp \
+    LatencyHistogram.cpp \
+    ProcessExtractor.cpp \
+    RunStats.cpp \
     SignedListWidget.cpp \
+    ZipIndex.cpp \
     main.cpp \
     MainWindow.cpp
 
 HEADERS += \
     About.h \
+    ArchiveDetector.h \
+    ArchiveType.h \
+    ChromeTrace.h \
     CmdOrGuiApp.h \
+    DeviceScheduler.h \
     Ex0days.h \
+    Extractor.h \
+    FileCopier.h \
+    FolderEntry.h \
+    FolderIndex.h \
+    FolderJournal.h \
+    FolderReport.h \
+    FolderScanner.h \
+    FolderWatcher.h \
+    FolderWorker.h \
+    JobController.h \
+    LatencyHistogram.h \
     MainWindow.h \
-    SignedListWidget.h
+    ProcessExtractor.h \
+    RunStats.h \
+    SignedListWidget.h \
+    ZipIndex.h
+
+# in-process extraction backend (qmake CONFIG+=libarchive)
+CONFIG(libarchive) : {
+    DEFINES += __USE_LIBARCHIVE__
+    SOURCES += LibArchiveExtractor.cpp
+    HEADERS += LibArchiveExtractor.h
+    LIBS    += -larchive
+}
 
 FORMS += \
     About.ui \
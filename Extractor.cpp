@@ -0,0 +1,53 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "Extractor.h"
+
+Extractor::Extractor(Ex0days &app, QObject *parent):
+    QObject(parent),
+    _app(app)
+{}
+
+QStringList Extractor::memoryFiles() const
+{
+    return QStringList();
+}
+
+QByteArray Extractor::memoryFileHeader(const QString &fileName, int size) const
+{
+    Q_UNUSED(fileName)
+    Q_UNUSED(size)
+    return QByteArray();
+}
+
+bool Extractor::writeMemoryFiles(const QString &outputDir)
+{
+    Q_UNUSED(outputDir)
+    return true;
+}
+
+void Extractor::clearMemoryFiles() {}
+
+Extractor::ProcessRun Extractor::lastRun() const
+{
+    return {0, QString(), 0, 0};
+}
@@ -0,0 +1,80 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef EXTRACTOR_H
+#define EXTRACTOR_H
+#include "Ex0days.h"
+
+/*!
+ * \brief The Extractor class is the interface of the extraction backends
+ * it unpacks either several independent zips (first stage)
+ * or a volume set (second stage, the first volume being the first of the list)
+ * in an output directory and emits finished with 0 on success
+ * and a non null exit code on failure (like 7z/unrar) so both backends give the same CSV
+ * Implementations:
+ *   - ProcessExtractor: the external programs (7z, unrar, unace, arj) run by QProcess
+ *   - LibArchiveExtractor: in-process extraction with libarchive on a thread pool
+ *     (that can also keep the unzipped volumes in memory for the second stage, cf --stream)
+ */
+class Extractor : public QObject
+{
+    Q_OBJECT
+
+protected:
+    Ex0days &_app;
+
+public:
+    //! an external program run by the extractor (for the --trace timeline)
+    struct ProcessRun
+    {
+        qint64  pid;
+        QString program;
+        qint64  start; //!< cf FolderReport::now
+        qint64  end;   //!< 0 while running
+    };
+
+    explicit Extractor(Ex0days &app, QObject *parent = nullptr);
+    ~Extractor() override = default;
+
+    virtual void extract(Ex0days::ARCHIVE_TYPE type, const QFileInfoList &archives, const QString &outputDir) = 0;
+    virtual void terminate() = 0;
+    virtual bool isRunning() const = 0;
+
+    //! what the extractor printed (used to find the broken zip of a batch)
+    virtual QByteArray readOutput() = 0;
+
+    //! files unzipped in memory by the first stage (--stream), relative to its output directory
+    virtual QStringList memoryFiles() const;
+    //! first bytes of one of them (to identify the second archive)
+    virtual QByteArray memoryFileHeader(const QString &fileName, int size) const;
+    //! flush them on disk when the second stage can't read them from memory
+    virtual bool writeMemoryFiles(const QString &outputDir);
+    virtual void clearMemoryFiles();
+
+    //! the last program it has run (pid 0 for the in-process extractions)
+    virtual ProcessRun lastRun() const;
+
+signals:
+    void finished(int exitCode);
+};
+
+#endif // EXTRACTOR_H
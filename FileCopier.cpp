@@ -0,0 +1,171 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "FileCopier.h"
+#include <QFile>
+#include <QFileInfo>
+
+#if defined(Q_OS_LINUX)
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <linux/fs.h>
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define __HAS_COPY_FILE_RANGE__
+#endif
+
+namespace {
+
+bool bufferedCopy(int srcFd, int dstFd, int bufferSize)
+{
+    QByteArray buffer(bufferSize, Qt::Uninitialized);
+    for (;;)
+    {
+        ssize_t nbRead = ::read(srcFd, buffer.data(), static_cast<size_t>(bufferSize));
+        if (nbRead == 0)
+            return true;
+        else if (nbRead < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        const char *data = buffer.constData();
+        while (nbRead > 0)
+        {
+            ssize_t nbWritten = ::write(dstFd, data, static_cast<size_t>(nbRead));
+            if (nbWritten < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data   += nbWritten;
+            nbRead -= nbWritten;
+        }
+    }
+}
+
+#ifdef __HAS_COPY_FILE_RANGE__
+//! returns false if nothing could be copied (not supported between those filesystems)
+bool copyFileRange(int srcFd, int dstFd, off_t size, bool &error)
+{
+    error = false;
+    off_t copied = 0;
+    while (copied < size)
+    {
+        ssize_t res = ::copy_file_range(srcFd, nullptr, dstFd, nullptr, static_cast<size_t>(size - copied), 0);
+        if (res < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (copied == 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL
+                                || errno == EOPNOTSUPP || errno == EPERM))
+                return false;
+            error = true;
+            return true;
+        }
+        else if (res == 0)
+            break; // the source has been truncated meanwhile
+        copied += res;
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+FileCopier::STRATEGY FileCopier::copy(const QString &srcPath, const QString &dstPath, bool allowHardlink)
+{
+    QByteArray src = QFile::encodeName(srcPath), dst = QFile::encodeName(dstPath);
+
+    int srcFd = ::open(src.constData(), O_RDONLY | O_CLOEXEC);
+    if (srcFd < 0)
+        return STRATEGY::FAILED;
+
+    struct stat srcStat;
+    if (::fstat(srcFd, &srcStat) != 0)
+    {
+        ::close(srcFd);
+        return STRATEGY::FAILED;
+    }
+
+    if (allowHardlink)
+    {
+        struct stat dstDirStat;
+        QByteArray dstDir = QFile::encodeName(QFileInfo(dstPath).absolutePath());
+        if (::stat(dstDir.constData(), &dstDirStat) == 0 && dstDirStat.st_dev == srcStat.st_dev
+                && ::link(src.constData(), dst.constData()) == 0)
+        {
+            ::close(srcFd);
+            return STRATEGY::HARDLINK;
+        }
+    }
+
+    int dstFd = ::open(dst.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, srcStat.st_mode & 0777);
+    if (dstFd < 0)
+    {
+        ::close(srcFd);
+        return STRATEGY::FAILED;
+    }
+
+    STRATEGY strategy = STRATEGY::FAILED;
+    if (::ioctl(dstFd, FICLONE, srcFd) == 0)
+        strategy = STRATEGY::REFLINK;
+#ifdef __HAS_COPY_FILE_RANGE__
+    else
+    {
+        bool error = false;
+        if (copyFileRange(srcFd, dstFd, srcStat.st_size, error))
+            strategy = error ? STRATEGY::FAILED : STRATEGY::COPY_RANGE;
+    }
+#endif
+
+    if (strategy == STRATEGY::FAILED && ::lseek(srcFd, 0, SEEK_SET) == 0
+            && ::ftruncate(dstFd, 0) == 0 && ::lseek(dstFd, 0, SEEK_SET) == 0
+            && bufferedCopy(srcFd, dstFd, sBufferSize))
+        strategy = STRATEGY::BUFFERED;
+
+    ::close(srcFd);
+    if (::close(dstFd) != 0)
+        strategy = STRATEGY::FAILED;
+
+    if (strategy == STRATEGY::FAILED)
+        ::unlink(dst.constData());
+
+    return strategy;
+}
+
+#else
+
+FileCopier::STRATEGY FileCopier::copy(const QString &srcPath, const QString &dstPath, bool allowHardlink)
+{
+    Q_UNUSED(allowHardlink) // QFile::link creates a shortcut on Windows, not a hardlink
+    return QFile::copy(srcPath, dstPath) ? STRATEGY::BUFFERED : STRATEGY::FAILED;
+}
+
+#endif
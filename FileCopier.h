@@ -0,0 +1,63 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef FILECOPIER_H
+#define FILECOPIER_H
+#include <QString>
+
+/*!
+ * \brief The FileCopier class is the copy engine used to stage the zips in the destination folder
+ * it tries the cheapest strategy first:
+ *   - a hardlink (if allowed) when the source and the destination are on the same device
+ *   - a reflink (FICLONE) on CoW filesystems (btrfs, XFS...)
+ *   - copy_file_range to copy within the kernel
+ *   - a plain buffered copy otherwise (the only one available on other OS than Linux)
+ */
+class FileCopier
+{
+public:
+    enum class STRATEGY : char {FAILED = 0, HARDLINK, REFLINK, COPY_RANGE, BUFFERED};
+
+    static STRATEGY copy(const QString &srcPath, const QString &dstPath, bool allowHardlink);
+
+    inline static QString strategyName(STRATEGY strategy);
+
+private:
+    static constexpr int sBufferSize = 1024*1024; //!< for the buffered copy
+};
+
+QString FileCopier::strategyName(STRATEGY strategy)
+{
+    switch (strategy) {
+    case STRATEGY::HARDLINK:
+        return "hardlink";
+    case STRATEGY::REFLINK:
+        return "reflink";
+    case STRATEGY::COPY_RANGE:
+        return "copy_file_range";
+    case STRATEGY::BUFFERED:
+        return "buffered";
+    default:
+        return "failed";
+    }
+}
+
+#endif // FILECOPIER_H
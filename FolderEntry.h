@@ -0,0 +1,54 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef FOLDERENTRY_H
+#define FOLDERENTRY_H
+#include "ZipIndex.h"
+#include <QStringList>
+#include <QMetaType>
+
+/*!
+ * \brief The FolderEntry struct is a 0day folder to extract as FolderScanner finds it
+ * with the central directories of its zips (read during the discovery, cf FolderScanner::indexFolder)
+ * so the size of what the folder will produce is known before it's dispatched to a worker
+ */
+struct FolderEntry
+{
+    QStringList     path;         //!< input folder then the sub folders
+    QByteArray      signature;    //!< of the zips when they've been indexed (cf FolderIndex)
+    QList<ZipIndex> zips;         //!< empty if not indexed
+    qint64          zipsSize;     //!< compressed total
+    qint64          unzippedSize; //!< uncompressed total of the zips (the volumes of the second archive)
+    qint64          lastModified; //!< of the most recent zip (ms since epoch)
+    quint64         device;       //!< st_dev of the folder (cf DeviceScheduler)
+    qint64          foundAt;      //!< when it has been indexed (cf FolderReport::now)
+    qint64          indexMs;      //!< time spent indexing it
+
+    FolderEntry(const QStringList &folderPath = QStringList()):
+        path(folderPath), signature(), zips(), zipsSize(0), unzippedSize(0), lastModified(0), device(0),
+        foundAt(0), indexMs(0)
+    {}
+
+    inline bool isIndexed() const { return !signature.isEmpty(); }
+};
+Q_DECLARE_METATYPE(FolderEntry)
+
+#endif // FOLDERENTRY_H
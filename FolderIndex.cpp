@@ -0,0 +1,145 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "FolderIndex.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QDir>
+#include <QDebug>
+
+FolderIndex::FolderIndex(const QString &path):
+    _path(path),
+    _entries(),
+    _file(path),
+    _stream(),
+    _testOnly(false),
+    _skip(true)
+{}
+
+FolderIndex::~FolderIndex()
+{
+    close();
+}
+
+void FolderIndex::load(bool testOnly, bool skip)
+{
+    close();
+    _entries.clear();
+    _testOnly = testOnly;
+    _skip     = skip;
+
+    int nbLines = 0;
+    if (_file.open(QIODevice::ReadOnly|QIODevice::Text))
+    {
+        while (!_file.atEnd())
+        {
+            QString line = QString::fromUtf8(_file.readLine()).trimmed();
+            QStringList fields = line.split(sSeparator);
+            if (fields.size() < 4)
+                continue; // truncated by a crash
+
+            ++nbLines;
+            QString folderPath = line.section(sSeparator, 3); // tabs are allowed in the path
+            _entries.insert(folderPath, {fields.at(0).toLatin1(), fields.at(1) == "test", fields.at(2) == "OK"});
+        }
+        _file.close();
+    }
+
+    if (nbLines > 2 * _entries.size())
+        _compact(nbLines);
+
+    if (_file.open(QIODevice::WriteOnly|QIODevice::Append|QIODevice::Text))
+    {
+        _stream.setDevice(&_file);
+        _stream.setCodec("UTF-8");
+    }
+    else
+        qCritical() << "Error opening the index " << _path << ": " << _file.errorString();
+}
+
+void FolderIndex::close()
+{
+    if (_file.isOpen())
+    {
+        _stream.flush();
+        _stream.setDevice(nullptr);
+        _file.close();
+    }
+}
+
+bool FolderIndex::isUpToDate(const QDir &folder) const
+{
+    if (!_skip)
+        return false;
+
+    auto it = _entries.constFind(folder.absolutePath());
+    if (it == _entries.cend() || !it->success || it->testOnly != _testOnly)
+        return false; // the KO folders are retried
+
+    QFileInfoList zips;
+    for (const QFileInfo &fi : folder.entryInfoList(QDir::Files|QDir::Hidden|QDir::Readable|QDir::NoSymLinks))
+    {
+        if (fi.suffix().toLower() == "zip")
+            zips << fi;
+    }
+    return it->signature == signature(zips);
+}
+
+void FolderIndex::record(const QString &folderPath, const QByteArray &signature, bool success)
+{
+    if (!_stream.device())
+        return;
+
+    _stream << signature << sSeparator
+            << (_testOnly ? "test" : "extract") << sSeparator
+            << (success ? "OK" : "KO") << sSeparator
+            << folderPath << "\n" << flush; // a crash shouldn't lose the previous folders
+}
+
+QByteArray FolderIndex::signature(const QFileInfoList &zips)
+{
+    QStringList zipSignatures;
+    for (const QFileInfo &zip : zips)
+        zipSignatures << QString("%1:%2:%3").arg(zip.fileName()).arg(zip.size()).arg(
+                             zip.lastModified().toMSecsSinceEpoch());
+    zipSignatures.sort();
+    return QCryptographicHash::hash(zipSignatures.join("\n").toUtf8(), QCryptographicHash::Md5).toHex();
+}
+
+void FolderIndex::_compact(int nbLines)
+{
+    QSaveFile file(_path);
+    if (!file.open(QIODevice::WriteOnly|QIODevice::Text))
+        return;
+
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    for (auto it = _entries.cbegin(), itEnd = _entries.cend(); it != itEnd; ++it)
+        stream << it->signature << sSeparator
+               << (it->testOnly ? "test" : "extract") << sSeparator
+               << (it->success ? "OK" : "KO") << sSeparator
+               << it.key() << "\n";
+    stream.flush();
+    if (file.commit())
+        qDebug() << "Index compacted: " << nbLines << " lines => " << _entries.size();
+}
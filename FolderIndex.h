@@ -0,0 +1,79 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef FOLDERINDEX_H
+#define FOLDERINDEX_H
+#include <QHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+class QDir;
+
+/*!
+ * \brief The FolderIndex class remembers the folders already processed
+ * so the next runs can skip the unchanged ones (unless --force)
+ * It is an append-only file in the log folder, one line per processed folder:
+ *    <signature>\t<mode>\t<OK|KO>\t<folder path>
+ * the signature is a hash of the names, sizes and mtimes of the zips of the folder
+ * the last line of a folder wins, the file is compacted when loaded
+ *
+ * The entries are only loaded before a scan, the scanner thread can then read them safely
+ * while the main thread appends the new results in the file.
+ */
+class FolderIndex
+{
+private:
+    struct Entry
+    {
+        QByteArray signature;
+        bool       testOnly;
+        bool       success;
+    };
+
+    const QString        _path;
+    QHash<QString, Entry> _entries; //!< read only during the scans
+    QFile                _file;
+    QTextStream          _stream;
+    bool                 _testOnly; //!< mode of the current job
+    bool                 _skip;     //!< false with --force
+
+public:
+    explicit FolderIndex(const QString &path);
+    ~FolderIndex();
+
+    //! (re)load the index before a new job
+    void load(bool testOnly, bool skip);
+    void close();
+
+    //! true if the folder has been processed successfully in the same mode with the same zips
+    bool isUpToDate(const QDir &folder) const;
+    void record(const QString &folderPath, const QByteArray &signature, bool success);
+
+    static QByteArray signature(const QFileInfoList &zips);
+
+private:
+    void _compact(int nbLines);
+
+    static constexpr const char *sSeparator = "\t";
+};
+
+#endif // FOLDERINDEX_H
@@ -0,0 +1,225 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "FolderJournal.h"
+#include <QDir>
+#include <QHash>
+#include <QDebug>
+
+const QStringList FolderJournal::sStateNames = {
+    "QUEUED", "STAGING", "UNZIPPED", "SECOND_STAGE", "EXTRACTED", "CLEANED", "ROLLED_BACK"
+};
+
+FolderJournal::FolderJournal(const QString &path):
+    _file(path), _lock(QString("%1.lock").arg(path))
+{
+    _lock.setStaleLockTime(0); // a lock is only stale if its process is dead
+}
+
+FolderJournal::~FolderJournal()
+{
+    _file.close();
+}
+
+bool FolderJournal::lock()
+{
+    return _lock.isLocked() || _lock.tryLock(0);
+}
+
+FolderJournal::Recovery FolderJournal::recover()
+{
+    struct Folder
+    {
+        QStringList folderPath;
+        STATE       state;
+        QStringList fields; //!< of the STAGING line (paths)
+        QStringList extractedFields;
+    };
+
+    Recovery recovery{QStringList(), true, QList<QStringList>(), 0, 0};
+    if (!_lock.isLocked())
+        return recovery; // the journal of another instance
+    if (!_file.open(QIODevice::ReadOnly|QIODevice::Text))
+        return recovery; // clean exit of the previous job
+
+    QHash<QString, Folder> folders;
+    QStringList order; // of the QUEUED lines
+    while (!_file.atEnd())
+    {
+        QString line = QString::fromUtf8(_file.readLine());
+        if (!line.endsWith('\n'))
+            break; // truncated by the crash
+        QStringList fields = line.left(line.size() - 1).split("\t");
+        QString type = fields.takeFirst();
+        if (type == "JOB")
+        {
+            recovery.roots   = fields;
+            recovery.scanned = false;
+            continue;
+        }
+        else if (type == "SCANNED")
+        {
+            recovery.scanned = true;
+            continue;
+        }
+
+        int state = sStateNames.indexOf(type);
+        if (state < 0 || fields.isEmpty())
+            continue;
+        if (state == static_cast<int>(STATE::QUEUED))
+        {
+            QString folder = fields.join("/");
+            if (!folders.contains(folder))
+                order << folder;
+            folders[folder] = {fields, STATE::QUEUED, QStringList(), QStringList()};
+            continue;
+        }
+
+        auto it = folders.find(fields.first());
+        if (it == folders.end())
+            continue;
+        it->state = static_cast<STATE>(state);
+        if (it->state == STATE::STAGING)
+            it->fields = fields;
+        else if (it->state == STATE::EXTRACTED)
+            it->extractedFields = fields;
+    }
+    _file.close();
+
+    for (const QString &folder : order)
+    {
+        Folder &f = folders[folder];
+        switch (f.state) {
+        case STATE::STAGING:
+        case STATE::UNZIPPED:
+        case STATE::SECOND_STAGE:
+            if (f.fields.size() >= 4)
+                rollback(folder, f.fields.at(1), f.fields.at(2), f.fields.at(3) == "1");
+            ++recovery.nbRolledBack;
+            recovery.folders << f.folderPath;
+            break;
+
+        case STATE::EXTRACTED:
+            // the output is complete, let's finish the cleaning
+            if (f.fields.size() >= 4 && f.extractedFields.size() >= 3)
+            {
+                QString outputPath = f.fields.at(1), workPath = f.fields.at(2);
+                bool delSrc = f.extractedFields.at(1) == "1", keepOutput = f.extractedFields.at(2) == "1";
+                if (!keepOutput)
+                    QDir(outputPath).removeRecursively();
+                for (const QString &fileName : f.extractedFields.mid(3))
+                    QFile::remove(QString("%1/%2").arg(workPath).arg(fileName));
+                if (workPath != outputPath)
+                    QDir(workPath).removeRecursively();
+                if (delSrc)
+                    QDir(folder).removeRecursively();
+            }
+            ++recovery.nbCleaned;
+            break;
+
+        case STATE::QUEUED:
+        case STATE::ROLLED_BACK:
+            recovery.folders << f.folderPath;
+            break;
+
+        default:
+            break;
+        }
+    }
+    return recovery;
+}
+
+void FolderJournal::startJob(const QStringList &roots)
+{
+    if (!_lock.isLocked())
+        return; // no journal for this run
+    _file.close();
+    if (!_file.open(QIODevice::WriteOnly|QIODevice::Truncate|QIODevice::Text))
+    {
+        qCritical() << "Error opening the journal " << _file.fileName() << ": " << _file.errorString();
+        return;
+    }
+    _write(QStringList("JOB") + roots);
+}
+
+void FolderJournal::scanDone()
+{
+    _write({"SCANNED"});
+}
+
+void FolderJournal::endJob()
+{
+    if (!_lock.isLocked())
+        return;
+    _file.close();
+    _file.remove();
+}
+
+void FolderJournal::queued(const QStringList &folderPath)
+{
+    _write(QStringList(sStateNames.at(static_cast<int>(STATE::QUEUED))) + folderPath);
+}
+
+void FolderJournal::staging(const QString &folder, const QString &outputPath, const QString &workPath, bool zipsMoved)
+{
+    _write({sStateNames.at(static_cast<int>(STATE::STAGING)), folder, outputPath, workPath, zipsMoved ? "1" : "0"});
+}
+
+void FolderJournal::extracted(const QString &folder, bool delSrc, bool keepOutput, const QStringList &intermediateFiles)
+{
+    _write(QStringList({sStateNames.at(static_cast<int>(STATE::EXTRACTED)), folder,
+                        delSrc ? "1" : "0", keepOutput ? "1" : "0"}) + intermediateFiles);
+}
+
+void FolderJournal::setState(const QString &folder, STATE state)
+{
+    _write({sStateNames.at(static_cast<int>(state)), folder});
+}
+
+void FolderJournal::rollback(const QString &folder, const QString &outputPath, const QString &workPath, bool zipsMoved)
+{
+    if (zipsMoved)
+    {
+        // --in-place: the zips are the only copy (they're only deleted once the folder is OK)
+        QDir workDir(workPath);
+        for (const QFileInfo &fi : workDir.entryInfoList(QDir::Files|QDir::Hidden|QDir::NoSymLinks))
+        {
+            QString srcPath = QString("%1/%2").arg(folder).arg(fi.fileName());
+            if (fi.suffix().toLower() == "zip" && !QFileInfo(srcPath).exists())
+                QFile::rename(fi.absoluteFilePath(), srcPath);
+        }
+    }
+    QDir(workPath).removeRecursively();
+    if (outputPath != workPath)
+        QDir(outputPath).removeRecursively();
+}
+
+void FolderJournal::_write(const QStringList &fields)
+{
+    if (!_file.isOpen())
+        return;
+
+    // flushed so it survives a kill (not a power loss)
+    _file.write(fields.join("\t").toUtf8());
+    _file.write("\n");
+    _file.flush();
+}
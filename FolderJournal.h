@@ -0,0 +1,95 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef FOLDERJOURNAL_H
+#define FOLDERJOURNAL_H
+#include <QFile>
+#include <QLockFile>
+#include <QStringList>
+
+/*!
+ * \brief The FolderJournal class is the write-ahead journal of the current job
+ * each state of a folder is written (and flushed) before the action it announces:
+ *    JOB          <input folders>
+ *    QUEUED       <folder path as FolderScanner emits it>
+ *    STAGING      <folder> <output path> <work path> <zips moved>
+ *    UNZIPPED     <folder>
+ *    SECOND_STAGE <folder>
+ *    EXTRACTED    <folder> <delete source> <keep output> <intermediate files>
+ *    CLEANED      <folder>
+ *    ROLLED_BACK  <folder>
+ *    SCANNED
+ * (fields separated by tabs)
+ * If a job is killed, the next run rolls back the partial outputs of the folders in progress,
+ * finishes the cleaning of the extracted ones and can resume the others (--resume)
+ * The journal is deleted once a job ends normally.
+ * It belongs to one instance at a time (lock file next to it): another ex0days started
+ * in the same folder runs without journal rather than rolling back the outputs of the first one.
+ */
+class FolderJournal
+{
+public:
+    enum class STATE : char {QUEUED = 0, STAGING, UNZIPPED, SECOND_STAGE, EXTRACTED, CLEANED, ROLLED_BACK};
+
+    //! what remains of the previous job
+    struct Recovery
+    {
+        QStringList        roots;         //!< input folders
+        bool               scanned;       //!< all the folders had been found
+        QList<QStringList> folders;       //!< not processed yet (including the rolled back ones)
+        int                nbRolledBack;
+        int                nbCleaned;     //!< extracted ones whose cleaning has been finished
+    };
+
+private:
+    QFile     _file;
+    QLockFile _lock; //!< held for the whole run by the instance that owns the journal
+
+public:
+    explicit FolderJournal(const QString &path);
+    ~FolderJournal();
+
+    //! false if another instance is using the journal (then nothing is recovered nor written)
+    bool lock();
+
+    //! roll back / clean what the previous job has left (to call before a new job)
+    Recovery recover();
+
+    void startJob(const QStringList &roots);
+    void scanDone();
+    void endJob(); //!< everything is done: no need to keep the journal
+
+    void queued(const QStringList &folderPath);
+    void staging(const QString &folder, const QString &outputPath, const QString &workPath, bool zipsMoved);
+    void extracted(const QString &folder, bool delSrc, bool keepOutput, const QStringList &intermediateFiles);
+    void setState(const QString &folder, STATE state);
+
+    //! remove the partial outputs of a folder (and give back its zips when they've been moved)
+    static void rollback(const QString &folder, const QString &outputPath, const QString &workPath, bool zipsMoved);
+
+private:
+    void _write(const QStringList &fields);
+
+    static const QStringList sStateNames;
+};
+
+#endif // FOLDERJOURNAL_H
@@ -0,0 +1,204 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "FolderReport.h"
+#include "ChromeTrace.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+FolderReport::FolderReport():
+    _path(), _workerId(-1), _foundAt(0), _indexMs(0),
+    _start(0), _startEpoch(0), _end(0), _inputBytes(0), _outputBytes(0), _archiveType(),
+    _success(false), _reason(), _stages()
+{}
+
+void FolderReport::start(const FolderEntry &entry, int workerId)
+{
+    *this = FolderReport();
+    _path       = entry.path.join("/");
+    _workerId   = workerId;
+    _foundAt    = entry.foundAt;
+    _indexMs    = entry.indexMs;
+    _start      = now();
+    _startEpoch = QDateTime::currentMSecsSinceEpoch();
+    _inputBytes = entry.zipsSize;
+}
+
+int FolderReport::begin(const QString &name, const QString &detail, qint64 bytes)
+{
+    _stages.append({name, detail, now(), -1, bytes, -1, 0, QString(), 0, 0});
+    return _stages.size() - 1;
+}
+
+void FolderReport::end(int stageId, int exitCode)
+{
+    if (stageId < 0 || stageId >= _stages.size())
+        return;
+    Stage &stage = _stages[stageId];
+    stage.ms       = now() - stage.start;
+    stage.exitCode = exitCode;
+}
+
+void FolderReport::setDetail(int stageId, const QString &detail)
+{
+    if (stageId >= 0 && stageId < _stages.size())
+        _stages[stageId].detail = detail;
+}
+
+void FolderReport::setProcess(int stageId, qint64 pid, const QString &program, qint64 start, qint64 end)
+{
+    if (stageId < 0 || stageId >= _stages.size() || pid == 0)
+        return;
+    Stage &stage    = _stages[stageId];
+    stage.pid       = pid;
+    stage.program   = program;
+    stage.procStart = start;
+    stage.procEnd   = end;
+}
+
+void FolderReport::finish(bool success, qint64 outputBytes)
+{
+    _end         = now();
+    _success     = success;
+    _outputBytes = outputBytes;
+    for (Stage &stage : _stages)
+    {
+        if (stage.ms < 0) // interrupted (failure of a sibling, stop...)
+            stage.ms = _end - stage.start;
+    }
+}
+
+QByteArray FolderReport::toJsonLine() const
+{
+    QJsonObject record;
+    record["path"]    = _path;
+    record["worker"]  = _workerId;
+    record["success"] = _success;
+    if (!_reason.isEmpty())
+        record["reason"] = _reason;
+    if (!_archiveType.isEmpty())
+        record["archive_type"] = _archiveType;
+    if (_foundAt)
+    {
+        record["discovery"] = QJsonObject{{"t", _epoch(_foundAt)}, {"ms", _indexMs}};
+        record["queued_ms"] = qMax<qint64>(0, _start - _foundAt - _indexMs);
+    }
+    record["start"]        = _startEpoch;
+    record["end"]          = _epoch(_end);
+    record["ms"]           = _end - _start;
+    record["input_bytes"]  = _inputBytes;
+    record["output_bytes"] = _outputBytes;
+
+    QJsonArray stages;
+    for (const Stage &stage : _stages)
+    {
+        QJsonObject obj{{"stage", stage.name}, {"t", _epoch(stage.start)}, {"ms", stage.ms}};
+        if (!stage.detail.isEmpty())
+            obj["detail"] = stage.detail;
+        if (stage.bytes)
+            obj["bytes"] = stage.bytes;
+        if (stage.exitCode >= 0)
+            obj["exit_code"] = stage.exitCode;
+        if (stage.pid)
+            obj["pid"] = stage.pid;
+        stages.append(obj);
+    }
+    record["stages"] = stages;
+
+    return QJsonDocument(record).toJson(QJsonDocument::Compact);
+}
+
+void FolderReport::trace(ChromeTrace &trace) const
+{
+    QString folderName = _path.section('/', -1);
+    if (_foundAt)
+    {
+        // the scanner indexes one folder at a time
+        trace.nameProcess(0, "discovery");
+        trace.nameThread(0, 0, "index");
+        trace.addSpan(0, 0, folderName, "discovery", _foundAt, _foundAt + _indexMs, QJsonObject{{"path", _path}});
+    }
+    if (_workerId < 0)
+    {
+        // refused before reaching a worker
+        trace.addInstant(0, 0, folderName, "failed", _end, QJsonObject{{"path", _path}, {"reason", _reason}});
+        return;
+    }
+
+    // one process per worker slot: its folders on the first thread, the parallel unzips on the next ones
+    int pid = _workerId + 1;
+    trace.nameProcess(pid, QString("worker #%1").arg(_workerId));
+    trace.nameThread(pid, 0, "folder");
+    QJsonObject args{{"path", _path}, {"success", _success},
+                     {"input_bytes", _inputBytes}, {"output_bytes", _outputBytes}};
+    if (_foundAt)
+        args["queued_ms"] = qMax<qint64>(0, _start - _foundAt - _indexMs);
+    if (!_reason.isEmpty())
+        args["reason"] = _reason;
+    trace.addSpan(pid, 0, folderName, _success ? "folder" : "failed", _start, _end, args);
+
+    QVector<qint64> laneEnds; // of the unzip threads
+    for (const Stage &stage : _stages)
+    {
+        qint64 tid = 0;
+        if (stage.name == "unzip")
+        {
+            int lane = 0;
+            while (lane < laneEnds.size() && laneEnds.at(lane) > stage.start)
+                ++lane;
+            if (lane == laneEnds.size())
+                laneEnds.append(0);
+            laneEnds[lane] = stage.start + stage.ms;
+            tid = lane + 1;
+            trace.nameThread(pid, tid, QString("unzip #%1").arg(tid));
+        }
+
+        QJsonObject stageArgs;
+        if (!stage.detail.isEmpty())
+            stageArgs["detail"] = stage.detail;
+        if (stage.bytes)
+            stageArgs["bytes"] = stage.bytes;
+        if (stage.exitCode >= 0)
+            stageArgs["exit_code"] = stage.exitCode;
+        trace.addSpan(pid, tid, stage.name, "stage", stage.start, stage.start + stage.ms, stageArgs);
+
+        if (stage.pid)
+        {
+            // nested in its stage
+            QJsonObject procArgs{{"pid", stage.pid}};
+            if (stage.exitCode >= 0)
+                procArgs["exit_code"] = stage.exitCode;
+            trace.addSpan(pid, tid, QString("%1 [%2]").arg(stage.program).arg(stage.pid), "process",
+                          stage.procStart, stage.procEnd ? stage.procEnd : stage.start + stage.ms, procArgs);
+        }
+    }
+}
+
+qint64 FolderReport::now()
+{
+    QElapsedTimer clock; // monotonic where the platform has one (ms since boot on Linux)
+    clock.start();
+    return clock.msecsSinceReference();
+}
@@ -0,0 +1,103 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef FOLDERREPORT_H
+#define FOLDERREPORT_H
+#include "FolderEntry.h"
+#include <QVector>
+class ChromeTrace;
+
+/*!
+ * \brief The FolderReport class times the stages of a folder for the JSON Lines report
+ * (./logs/ex0days_<date>.jsonl, one line per folder, OK or KO):
+ * discovery (from the FolderEntry), queue, preflight, copy, each unzip (or batch of zips),
+ * the second extraction and the cleanup with their bytes and exit codes.
+ * The stages are timed on a monotonic clock (cf now) as the wall clock can jump (NTP, DST)
+ * only the start of the folder is read on the wall clock: the timestamps of the report are
+ * derived from it (ms since epoch), durations in ms
+ * The same stages make the timeline of --trace (cf ChromeTrace)
+ */
+class FolderReport
+{
+    friend class RunStats; //!< to aggregate the stages
+
+private:
+    struct Stage
+    {
+        QString name;
+        QString detail;   //!< zip(s), archive, copy strategies...
+        qint64  start;
+        qint64  ms;       //!< -1 while running
+        qint64  bytes;    //!< input of the stage
+        int     exitCode; //!< -1 if none (or not finished)
+        qint64  pid;      //!< of the extractor process (0 if none or in process)
+        QString program;
+        qint64  procStart;
+        qint64  procEnd;
+    };
+
+    QString        _path;
+    int            _workerId;
+    qint64         _foundAt;   //!< when the discovery indexed the folder (0 if it didn't)
+    qint64         _indexMs;
+    qint64         _start;     //!< given to a worker
+    qint64         _startEpoch; //!< same on the wall clock (ms since epoch)
+    qint64         _end;
+    qint64         _inputBytes;
+    qint64         _outputBytes;
+    QString        _archiveType; //!< of the second archive (cf Ex0days::archiveTypeName)
+    bool           _success;
+    QString        _reason;    //!< of the failure (as in the CSV)
+    QVector<Stage> _stages;
+
+public:
+    FolderReport();
+
+    void start(const FolderEntry &entry, int workerId);
+    inline bool isStarted() const;
+
+    int  begin(const QString &name, const QString &detail = QString(), qint64 bytes = 0); //!< returns the stage id
+    void end(int stageId, int exitCode = 0);
+    void setDetail(int stageId, const QString &detail);
+    void setProcess(int stageId, qint64 pid, const QString &program, qint64 start, qint64 end);
+
+    inline void setInputBytes(qint64 bytes);
+    inline void setReason(const QString &reason);
+    inline void setArchiveType(const QString &type);
+    void finish(bool success, qint64 outputBytes);
+
+    QByteArray toJsonLine() const;
+    void trace(ChromeTrace &trace) const;
+
+    static qint64 now(); //!< ms on the monotonic clock (not related to the epoch)
+
+private:
+    inline qint64 _epoch(qint64 time) const; //!< from now() to ms since epoch
+};
+
+bool FolderReport::isStarted() const { return _start != 0; }
+void FolderReport::setInputBytes(qint64 bytes) { _inputBytes = bytes; }
+void FolderReport::setArchiveType(const QString &type) { _archiveType = type; }
+void FolderReport::setReason(const QString &reason) { if (_reason.isEmpty()) _reason = reason; }
+qint64 FolderReport::_epoch(qint64 time) const { return _startEpoch + time - _start; }
+
+#endif // FOLDERREPORT_H
@@ -0,0 +1,185 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "FolderScanner.h"
+#include "FolderIndex.h"
+#include "DeviceScheduler.h"
+#include "FolderReport.h"
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QRunnable>
+#include <QDebug>
+
+/*!
+ * \brief The FolderIndexJob class reads the central directories of the zips of a folder
+ * in the indexing pool of the scanner and emits the folder once done
+ */
+class FolderIndexJob : public QRunnable
+{
+private:
+    FolderScanner      &_scanner;
+    const int           _scanId;
+    const QStringList   _folderPath;
+    const QFileInfoList _zips;
+    const bool          _watchScan;
+
+public:
+    FolderIndexJob(FolderScanner &scanner, int scanId, const QStringList &folderPath,
+                   const QFileInfoList &zips, bool watchScan):
+        QRunnable(),
+        _scanner(scanner), _scanId(scanId), _folderPath(folderPath), _zips(zips), _watchScan(watchScan)
+    {}
+
+    void run() override
+    {
+        if (_scanId <= _scanner._stopScanId.load())
+            return;
+        _scanner._indexed(_scanId, FolderScanner::_indexFolder(_folderPath, _zips), _watchScan);
+    }
+};
+
+FolderScanner::FolderScanner(const FolderIndex *index):
+    QObject(),
+    _stopScanId(0),
+    _scanMutex(),
+    _index(index),
+    _lastIndex(), _scanIndex(), _scanIndexMutex(),
+    _indexPool()
+{
+    _indexPool.setMaxThreadCount(sIndexThreads);
+}
+
+void FolderScanner::stop(int scanId)
+{
+    _stopScanId.store(scanId);
+}
+
+void FolderScanner::waitScanDone()
+{
+    QMutexLocker lock(&_scanMutex);
+}
+
+void FolderScanner::onScanFolders(int scanId, const QStringList &srcFolders, bool watchScan)
+{
+    QMutexLocker lock(&_scanMutex);
+    for (const QString &srcFolder : srcFolders)
+    {
+        if (scanId <= _stopScanId.load())
+            break;
+        QFileInfo fi(srcFolder);
+        _browseDir(scanId, srcFolder, {fi.absolutePath(), fi.fileName()}, watchScan); // absolute for the journal
+    }
+    _indexPool.waitForDone(); // the folders are all emitted before the end of the scan
+
+    if (watchScan && scanId > _stopScanId.load())
+        _lastIndex.swap(_scanIndex); // the folders that are gone are forgotten
+    else if (!watchScan)
+        _lastIndex.clear();
+    _scanIndex.clear();
+    emit scanDone(scanId);
+}
+
+void FolderScanner::_browseDir(int scanId, const QString &folderPath, const QStringList &parents, bool watchScan)
+{
+    QDir dir(folderPath);
+    QFileInfoList subFolders = dir.entryInfoList(QDir::AllDirs|QDir::Hidden|QDir::NoDotAndDotDot|QDir::NoSymLinks,  QDir::Name);
+    if (subFolders.isEmpty())
+    {
+#ifdef __DEBUG__
+        qDebug() << "0day folder: " << dir.absolutePath();
+#endif
+        if (_index && _index->isUpToDate(dir))
+        {
+            emit folderSkipped(scanId, dir.absolutePath());
+            return;
+        }
+
+        QFileInfoList zips = _zipFiles(folderPath);
+        if (watchScan && !zips.isEmpty())
+        {
+            auto it = _lastIndex.constFind(parents.join("/"));
+            if (it != _lastIndex.cend() && it->signature == FolderIndex::signature(zips))
+            {
+                _indexed(scanId, *it, watchScan); // same zips: same central directories
+                return;
+            }
+        }
+        _indexPool.start(new FolderIndexJob(*this, scanId, parents, zips, watchScan));
+    }
+    else
+    {
+        for (const QFileInfo &subFolder : subFolders)
+        {
+            if (scanId <= _stopScanId.load())
+                return;
+            QStringList newParents(parents);
+            newParents << subFolder.fileName();
+            _browseDir(scanId, subFolder.absoluteFilePath(), newParents, watchScan);
+        }
+    }
+}
+
+void FolderScanner::_indexed(int scanId, const FolderEntry &entry, bool watchScan)
+{
+    if (watchScan)
+    {
+        QMutexLocker lock(&_scanIndexMutex);
+        _scanIndex.insert(entry.path.join("/"), entry);
+    }
+    emit folderFound(scanId, entry);
+}
+
+FolderEntry FolderScanner::indexFolder(const QStringList &folderPath)
+{
+    return _indexFolder(folderPath, _zipFiles(folderPath.join("/")));
+}
+
+QFileInfoList FolderScanner::_zipFiles(const QString &folderPath)
+{
+    QFileInfoList zips;
+    for (const QFileInfo &fi : QDir(folderPath).entryInfoList(QDir::Files|QDir::Hidden|QDir::Readable|QDir::NoSymLinks, QDir::Name))
+    {
+        if (fi.suffix().toLower() == "zip")
+            zips << fi;
+    }
+    return zips;
+}
+
+FolderEntry FolderScanner::_indexFolder(const QStringList &folderPath, const QFileInfoList &zips)
+{
+    FolderEntry entry(folderPath);
+    entry.foundAt = FolderReport::now();
+    entry.device  = DeviceScheduler::deviceOf(folderPath.join("/"));
+    for (const QFileInfo &fi : zips)
+    {
+        ZipIndex index;
+        index.read(fi); // a broken zip is kept for the pre-flight of the worker
+        entry.zips << index;
+        entry.zipsSize     += fi.size();
+        entry.unzippedSize += index.unzippedSize();
+        entry.lastModified  = qMax(entry.lastModified, fi.lastModified().toMSecsSinceEpoch());
+    }
+    if (!zips.isEmpty())
+        entry.signature = FolderIndex::signature(zips);
+    entry.indexMs = FolderReport::now() - entry.foundAt;
+    return entry;
+}
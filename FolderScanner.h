@@ -0,0 +1,86 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef FOLDERSCANNER_H
+#define FOLDERSCANNER_H
+#include <QObject>
+#include <QStringList>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QThreadPool>
+#include <QHash>
+#include <QFileInfo>
+#include "FolderEntry.h"
+class FolderIndex;
+
+/*!
+ * \brief The FolderScanner class browses recursively the input folders in its own thread
+ * and emits each 0day folder (leaf folder) as soon as it is found
+ * so the workers can start extracting while the tree is still being scanned
+ * The central directories of the zips are read by a small thread pool (cf FolderEntry)
+ * so several folders are indexed while the tree is browsed (they're emitted once indexed)
+ * With --watch, a folder whose zips haven't changed since the previous scan isn't read again
+ * (the failed ones and the ones still waiting to be stable are found by every scan)
+ */
+class FolderScanner : public QObject
+{
+    Q_OBJECT
+
+private:
+    QAtomicInt _stopScanId; //!< set from the main thread to abort the scans up to this one
+    QMutex     _scanMutex;  //!< held during a scan (cf waitScanDone)
+    const FolderIndex *_index; //!< to skip the folders already processed
+    QHash<QString, FolderEntry> _lastIndex; //!< --watch: the folders indexed by the previous scan
+    QHash<QString, FolderEntry> _scanIndex; //!< --watch: the folders indexed by the running scan
+    QMutex      _scanIndexMutex; //!< _scanIndex is filled by the indexing threads
+    QThreadPool _indexPool;
+
+public:
+    explicit FolderScanner(const FolderIndex *index = nullptr);
+    ~FolderScanner() override = default;
+
+    void stop(int scanId); //!< abort the scans up to scanId (the running one and the ones still queued)
+    void waitScanDone();   //!< from the main thread: returns once the running scan is over
+
+    //! read the central directories of the zips of a folder
+    static FolderEntry indexFolder(const QStringList &folderPath);
+
+signals:
+    void folderFound(int scanId, const FolderEntry &entry);
+    void folderSkipped(int scanId, const QString &folderPath); //!< unchanged since it has been processed
+    void scanDone(int scanId);
+
+public slots:
+    void onScanFolders(int scanId, const QStringList &srcFolders, bool watchScan);
+
+private:
+    void _browseDir(int scanId, const QString &folderPath, const QStringList &parents, bool watchScan);
+    void _indexed(int scanId, const FolderEntry &entry, bool watchScan); //!< from the indexing threads
+
+    static QFileInfoList _zipFiles(const QString &folderPath);
+    static FolderEntry _indexFolder(const QStringList &folderPath, const QFileInfoList &zips);
+
+    static constexpr int sIndexThreads = 4; //!< a few reads per zip: more would only seek
+
+    friend class FolderIndexJob;
+};
+
+#endif // FOLDERSCANNER_H
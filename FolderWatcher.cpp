@@ -0,0 +1,123 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "FolderWatcher.h"
+#include <QFileInfo>
+#include <QDebug>
+
+FolderWatcher::FolderWatcher(QObject *parent):
+    QObject(parent),
+    _fsWatcher(), _pollTimer(), _changeTimer(),
+    _roots(), _intervalMs(0),
+    _candidates(), _processed(), _watchedPaths()
+{
+    connect(&_fsWatcher,   &QFileSystemWatcher::directoryChanged, this, &FolderWatcher::onDirectoryChanged);
+    connect(&_pollTimer,   &QTimer::timeout, this, &FolderWatcher::scanNeeded);
+    connect(&_changeTimer, &QTimer::timeout, this, &FolderWatcher::scanNeeded);
+    _changeTimer.setSingleShot(true);
+}
+
+void FolderWatcher::start(const QStringList &roots, int intervalSec)
+{
+    _roots      = roots;
+    _intervalMs = intervalSec * 1000;
+    for (const QString &root : roots)
+        _watch(root);
+
+    _pollTimer.start(_intervalMs);
+    emit scanNeeded();
+}
+
+void FolderWatcher::addCandidate(const FolderEntry &entry)
+{
+    QString path = entry.path.join("/");
+    _watch(path);
+    _watch(QFileInfo(path).path()); // to be notified of the new siblings
+
+    auto it = _candidates.find(path);
+    if (it == _candidates.end())
+        it = _candidates.insert(path, {FolderEntry(entry.path), QElapsedTimer(), false});
+    it->seen = true;
+
+    if (!entry.isIndexed())
+    {
+        it->entry = entry; // the download hasn't started
+        it->stableTime.invalidate();
+        return;
+    }
+
+    if (entry.signature != it->entry.signature)
+        it->stableTime.start();
+    it->entry = entry; // the index of the last scan
+}
+
+QList<FolderEntry> FolderWatcher::takeReadyFolders()
+{
+    QList<FolderEntry> readyFolders;
+    for (auto it = _candidates.begin(); it != _candidates.end(); )
+    {
+        if (!it->seen)
+        {
+            // the folder is gone (deleted once extracted, moved...)
+            _processed.remove(it.key());
+            _unwatch(it.key());
+            it = _candidates.erase(it);
+            continue;
+        }
+
+        it->seen = false;
+        if (it->stableTime.isValid() && it->stableTime.elapsed() >= _intervalMs
+                && _processed.value(it.key()) != it->entry.signature)
+        {
+            _processed.insert(it.key(), it->entry.signature);
+            readyFolders << it->entry;
+        }
+        ++it;
+    }
+    return readyFolders;
+}
+
+void FolderWatcher::onDirectoryChanged(const QString &path)
+{
+#ifdef __DEBUG__
+    qDebug() << "[FolderWatcher] change in " << path;
+#else
+    Q_UNUSED(path)
+#endif
+    if (!_changeTimer.isActive())
+        _changeTimer.start(sChangeDelay);
+}
+
+void FolderWatcher::_watch(const QString &path)
+{
+    if (_watchedPaths.contains(path))
+        return;
+
+    _watchedPaths.insert(path);
+    _fsWatcher.addPath(path); // may fail (inotify limit), the polling is there for that
+}
+
+void FolderWatcher::_unwatch(const QString &path)
+{
+    if (_watchedPaths.remove(path))
+        _fsWatcher.removePath(path);
+}
@@ -0,0 +1,89 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef FOLDERWATCHER_H
+#define FOLDERWATCHER_H
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include "FolderEntry.h"
+
+/*!
+ * \brief The FolderWatcher class keeps ex0days running on the input folders (--watch)
+ * it asks for a scan on each change notified by inotify (QFileSystemWatcher)
+ * and periodically as a fallback (network shares, inotify limit reached...)
+ * The 0day folders found by the scans are candidates: they're ready to be processed
+ * once the signature of their zips hasn't changed for a whole interval (download finished)
+ */
+class FolderWatcher : public QObject
+{
+    Q_OBJECT
+
+private:
+    struct Candidate
+    {
+        FolderEntry   entry;      //!< as FolderScanner emits it (with the signature of the zips)
+        QElapsedTimer stableTime; //!< since the last change of the signature
+        bool          seen;       //!< found by the current scan
+    };
+
+    QFileSystemWatcher         _fsWatcher;
+    QTimer                     _pollTimer;   //!< polling fallback
+    QTimer                     _changeTimer; //!< to coalesce the notifications
+    QStringList                _roots;
+    int                        _intervalMs;  //!< a folder must be stable that long
+    QHash<QString, Candidate>  _candidates;
+    QHash<QString, QByteArray> _processed;   //!< signatures of the folders already given to a job
+    QSet<QString>              _watchedPaths;
+
+public:
+    explicit FolderWatcher(QObject *parent = nullptr);
+    ~FolderWatcher() override = default;
+
+    void start(const QStringList &roots, int intervalSec);
+    inline const QStringList &roots() const;
+    inline int interval() const;
+
+    void addCandidate(const FolderEntry &entry); //!< found by a scan
+    QList<FolderEntry> takeReadyFolders();       //!< at the end of a scan
+
+signals:
+    void scanNeeded();
+
+private slots:
+    void onDirectoryChanged(const QString &path);
+
+private:
+    void _watch(const QString &path);
+    void _unwatch(const QString &path);
+
+    static constexpr int sChangeDelay = 1000; //!< ms to wait for the other notifications
+};
+
+const QStringList &FolderWatcher::roots() const { return _roots; }
+int FolderWatcher::interval() const { return _intervalMs / 1000; }
+
+#endif // FOLDERWATCHER_H
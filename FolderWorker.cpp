@@ -0,0 +1,759 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "FolderWorker.h"
+#include "FileCopier.h"
+#include "Extractor.h"
+#include "FolderIndex.h"
+#include "FolderJournal.h"
+#include "ArchiveDetector.h"
+#include "FolderScanner.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QDebug>
+
+const QString FolderWorker::sBatchArchiveLine = "Extracting archive:";
+
+FolderWorker::FolderWorker(Ex0days &app, int id):
+    QObject(),
+    _app(app), _id(id),
+    _state(STATE::IDLE),
+    _extractors(), _streamer(nullptr), _streaming(false),
+    _workPath(), _stagingReserved(0), _dstReserved(0), _devices(),
+    _srcDir(nullptr),
+    _currentPath(), _signature(), _unzippedSize(0),
+    _zipFiles(), _movedZips(),
+    _unzipTasks(), _unzipExtractors(),
+    _unzipChunk(1), _batchFallback(false), _unzipFailed(false),
+    _fistArchive(),
+    _archiveType(Ex0days::ARCHIVE_TYPE::UNKNOWN),
+    _unzippedFiles(),
+    _report(), _unzipStages(), _extractStage(-1)
+{
+    // queued to let hand to the HMI and avoid stack overflow ;)
+    connect(this, &FolderWorker::unzipNext, this, &FolderWorker::onUnzipNextFile, Qt::QueuedConnection);
+}
+
+FolderWorker::~FolderWorker()
+{
+    _clearDir(); // the extractors are our children: they stop their extraction when deleted
+}
+
+void FolderWorker::processFolder(const FolderEntry &entry, qint64 dstReserved, qint64 stagingReserved)
+{
+    _clearDir();
+    _report.start(entry, _id);
+    _dstReserved     = dstReserved; // released once the folder is cleaned
+    _stagingReserved = stagingReserved;
+    _devices      = _app._folderDevices(entry); // acquired by the app too
+    _currentPath  = entry.path;
+    _unzippedSize = entry.unzippedSize;
+    _srcDir  = new QDir(_currentPath.join("/"));
+    QFileInfoList files = _srcDir->entryInfoList(QDir::Files|QDir::Hidden|QDir::Readable|QDir::NoSymLinks, QDir::Name);
+    if (files.isEmpty())
+    {
+        _failExtract(tr("empty folder"));
+        _goToNextFolder(false);
+        return;
+    }
+
+    qDebug() << tr("[worker #%1] %2 ===>").arg(_id).arg(_srcDir->absolutePath());
+    QFileInfoList zips;
+    for (const QFileInfo &fi : files)
+    {
+        if  (fi.suffix().toLower() == "zip")
+            zips << fi;
+    }
+
+    if (zips.isEmpty())
+    {
+        _failExtract(tr("no zip files"));
+        _goToNextFolder(false);
+        return;
+    }
+
+    int preflightStage = _report.begin("preflight");
+    _signature = FolderIndex::signature(zips);
+    FolderEntry folder(entry);
+    if (entry.signature != _signature) // not indexed during the discovery or changed since
+        folder = FolderScanner::indexFolder(_currentPath);
+    _report.setInputBytes(folder.zipsSize);
+    QString problem = _preflight(folder.zips);
+    _report.end(preflightStage, problem.isEmpty() ? 0 : 1);
+    if (!problem.isEmpty())
+    {
+        _failExtract(problem);
+        _goToNextFolder(false);
+        return;
+    }
+
+    // what we keep in memory or in the staging folder are the unzipped volumes
+    qint64 zipsSize = folder.zipsSize, unzippedSize = folder.unzippedSize;
+    _streaming = _app._stream && entry.unzippedSize <= Ex0days::sMaxStreamSize; // as admitted by Ex0days
+
+    // Copy all zip in dest folder (unless we unzip them from the source)
+    if (_app._debug)
+    {
+        _app._log(tr("Processing %1 (%2 zips)").arg(_srcDir->absolutePath()).arg(zips.size()));
+        if (_app._stream && !_streaming)
+            _app._log(tr("  - too big to be unzipped in memory (%1 MB)").arg(unzippedSize / 1024 / 1024));
+    }
+    QString subPath = _subPath();
+    _workPath = _copyDirPath();
+    if (_stagingReserved)
+    {
+        // the copies of the zips and the unzipped volumes (the zips are deleted once unzipped)
+        _workPath = QString("%1/%2").arg(_app._stagingPath).arg(subPath);
+        if (!QDir().mkpath(_workPath))
+            qCritical() << "Error creating folder: " << _workPath;
+    }
+    else if (!_streaming && !_app._stagingPath.isEmpty() && _app._debug)
+        _app._log(tr("  - no room in the staging folder, unzipping in the output"));
+    _app._journal->staging(_journalKey(), _copyDirPath(), _workPath, _app._staging == Ex0days::STAGING::MOVE);
+    if (!_streaming && !_app._dstDir->mkpath(subPath)) // libarchive creates it when needed
+        qCritical() << "Error creating folder: " << _app._dstDir->absolutePath() << "/" << subPath;
+    QMap<FileCopier::STRATEGY, int> copyStrategies;
+    int nbMoved = 0, nbCopyErrors = 0;
+    int copyStage = _streaming || _app._staging == Ex0days::STAGING::NO_COPY ? -1 : _report.begin("copy", QString(), zipsSize);
+    for (const QFileInfo &fi : zips)
+    {
+        if (_streaming || _app._staging == Ex0days::STAGING::NO_COPY)
+        {
+            _zipFiles << fi;
+            continue;
+        }
+
+        QFileInfo copy(QString("%1/%2").arg(_workPath).arg(fi.fileName()));
+        // the rename only works on the same filesystem, otherwise we fall back on a copy
+        if (_app._staging == Ex0days::STAGING::MOVE && QFile::rename(fi.absoluteFilePath(), copy.absoluteFilePath()))
+        {
+            _zipFiles << copy;
+            _movedZips << copy;
+            ++nbMoved;
+            continue;
+        }
+
+        FileCopier::STRATEGY strategy = FileCopier::copy(fi.absoluteFilePath(), copy.absoluteFilePath(), _app._allowHardlink);
+        if (strategy != FileCopier::STRATEGY::FAILED)
+        {
+            _zipFiles << copy;
+            ++copyStrategies[strategy];
+        }
+        else
+        {
+            ++nbCopyErrors;
+            qCritical() << "Error copying file: " << fi.absoluteFilePath()
+                        << " to " << copy.absoluteFilePath();
+        }
+    }
+
+    QStringList strategies;
+    for (auto it = copyStrategies.cbegin(), itEnd = copyStrategies.cend(); it != itEnd; ++it)
+        strategies << QString("%1 (%2)").arg(FileCopier::strategyName(it.key())).arg(it.value());
+    if (_app._debug && !strategies.isEmpty())
+        _app._log(tr("  - zips copied by: %1").arg(strategies.join(", ")));
+    if (nbMoved)
+        strategies.prepend(QString("move (%1)").arg(nbMoved));
+    _report.setDetail(copyStage, strategies.join(", "));
+    _report.end(copyStage, nbCopyErrors);
+
+    _state = STATE::UNZIP;
+    if (_streaming) // one single job keeps all the volumes in memory
+        _unzipChunk = _zipFiles.size();
+    else if (_app._batchUnzip) // the zips are shared between the 7z we can run in parallel
+        _unzipChunk = qMax(1, (_zipFiles.size() + _app._unzipJobs - 1) / _app._unzipJobs);
+    onUnzipNextFile();
+}
+
+QString FolderWorker::_preflight(const QList<ZipIndex> &indexes) const
+{
+    // read in place: a broken folder costs neither a copy nor an unzip
+    for (const ZipIndex &index : indexes)
+    {
+        if (!index.error().isEmpty())
+            return QString("%1 %2").arg(index.fileName()).arg(index.error());
+    }
+    return ZipIndex::checkVolumeSets(indexes);
+}
+
+void FolderWorker::stop()
+{
+    for (Extractor *extractor : _extractors)
+        extractor->terminate();
+    if (_streamer)
+        _streamer->terminate();
+    _terminateUnzips();
+}
+
+void FolderWorker::onUnzipNextFile()
+{
+    if (_state != STATE::UNZIP || _unzipFailed)
+        return; // not our business or waiting for the siblings of a broken zip
+
+    if (_app._stopProcess)
+    {
+        if (_unzipTasks.isEmpty())
+            _abort();
+        return;
+    }
+
+    if (_zipFiles.isEmpty())
+    {
+        if (_unzipTasks.isEmpty())
+            _doSecondExtract(); // join: all the zips are extracted
+        return;
+    }
+
+    // launch as many extractions as the folder (--unzip-jobs) and the global budget (--max-procs) allow
+    while (!_zipFiles.isEmpty() && _unzipTasks.size() < _app._unzipJobs)
+    {
+        Extractor *extractor = _availableUnzipExtractor();
+        if (!extractor)
+            break;
+
+        int nbZips = _batchFallback ? 1 : _unzipChunk;
+        QFileInfoList zips;
+        while (!_zipFiles.isEmpty() && zips.size() < nbZips)
+            zips << _zipFiles.dequeue();
+        _unzipTasks.insert(extractor, zips);
+        QStringList zipNames;
+        qint64 zipsSize = 0;
+        for (const QFileInfo &zip : zips)
+        {
+            zipNames << zip.fileName();
+            zipsSize += zip.size();
+        }
+        _unzipStages.insert(extractor, _report.begin("unzip", zipNames.join(","), zipsSize));
+        extractor->extract(Ex0days::ARCHIVE_TYPE::ZIP, zips, _workPath);
+    }
+}
+
+void FolderWorker::_onExtractorFinished(Extractor *extractor, int exitCode)
+{
+    if (_unzipTasks.contains(extractor))
+        _onUnzipFinished(extractor, exitCode);
+    else if (_app._stopProcess)
+        _abort();
+    else if (_state == STATE::FINAL)
+    {
+        _endStage(_extractStage, extractor, exitCode);
+        bool success = exitCode == 0;
+        if (success)
+            _app._log(tr("%1 OK").arg(_srcDir->absolutePath()), true);
+        else
+            _failExtract(tr("error #%1 extracting archive: %2").arg(exitCode).arg(_fistArchive.fileName()));
+
+        _goToNextFolder(success);
+    }
+}
+
+Extractor *FolderWorker::_extractor(Ex0days::ARCHIVE_TYPE type)
+{
+    Extractor *extractor = _extractors.value(type, nullptr);
+    if (!extractor)
+    {
+        extractor = _newExtractor(type);
+        _extractors.insert(type, extractor);
+    }
+    return extractor;
+}
+
+Extractor *FolderWorker::_newExtractor(Ex0days::ARCHIVE_TYPE type, bool inMemory)
+{
+    Extractor *extractor = _app._newExtractor(type, this, inMemory);
+    connect(extractor, &Extractor::finished,
+            this, [this, extractor](int exitCode){ _onExtractorFinished(extractor, exitCode); });
+    return extractor;
+}
+
+Extractor *FolderWorker::_streamExtractor()
+{
+    if (!_streamer)
+        _streamer = _newExtractor(Ex0days::ARCHIVE_TYPE::ZIP, true);
+    return _streamer;
+}
+
+Extractor *FolderWorker::_availableUnzipExtractor()
+{
+    if (_streaming)
+        return _unzipTasks.contains(_streamExtractor()) ? nullptr : _streamExtractor();
+
+    // the folder always owns one extractor, the others need a slot of the global budget
+    Extractor *extractor = _extractor(Ex0days::ARCHIVE_TYPE::ZIP);
+    if (!_unzipTasks.contains(extractor))
+        return extractor;
+
+    if (!_app._acquireProcSlot())
+        return nullptr;
+
+    for (Extractor *extraExtractor : _unzipExtractors)
+    {
+        if (!_unzipTasks.contains(extraExtractor))
+            return extraExtractor;
+    }
+
+    extractor = _newExtractor(Ex0days::ARCHIVE_TYPE::ZIP);
+    _unzipExtractors << extractor;
+    return extractor;
+}
+
+void FolderWorker::_onUnzipFinished(Extractor *extractor, int exitCode)
+{
+    QFileInfoList zips = _unzipTasks.take(extractor);
+    _endStage(_unzipStages.take(extractor), extractor, exitCode);
+    if (_unzipExtractors.contains(extractor))
+        _app._releaseProcSlot();
+
+    qDebug() << "Zips extracted: " << zips.size() << " (first: " << zips.value(0).fileName() << ") : " << exitCode;
+
+    if (_app._stopProcess)
+    {
+        if (_unzipTasks.isEmpty())
+            _abort();
+        return;
+    }
+
+    if (_unzipFailed)
+    {
+        // a sibling has failed, we were waiting for everybody to stop
+        if (_unzipTasks.isEmpty())
+            _goToNextFolder(false);
+        return;
+    }
+
+    if (exitCode == 0)
+    {
+        for (const QFileInfo &zip : zips)
+            _deleteStagedZip(zip);
+        emit unzipNext();
+        return;
+    }
+
+    QFileInfo brokenZip = zips.size() == 1 ? zips.first() : _failedZipOfBatch(zips, extractor->readOutput());
+    if (brokenZip.fileName().isEmpty())
+    {
+        // we can't say which one is broken: let's replay them one by one
+        if (_app._debug)
+            _app._log(tr("  - error #%1 on a batch of zips, unzipping them one by one").arg(exitCode));
+        for (const QFileInfo &zip : zips)
+            _zipFiles << zip;
+        _batchFallback = true;
+        emit unzipNext();
+    }
+    else
+    {
+        // no need to waste time on the other zips, the folder is KO
+        _unzipFailed = true;
+        _failExtract(tr("error #%1 on zip file: %2").arg(exitCode).arg(brokenZip.fileName()));
+        if (_unzipTasks.isEmpty())
+            _goToNextFolder(false);
+        else
+            _terminateUnzips();
+    }
+}
+
+void FolderWorker::_terminateUnzips()
+{
+    for (auto it = _unzipTasks.cbegin(), itEnd = _unzipTasks.cend(); it != itEnd; ++it)
+        it.key()->terminate();
+}
+
+QFileInfo FolderWorker::_failedZipOfBatch(const QFileInfoList &zips, const QByteArray &output) const
+{
+    // 7z prints "Extracting archive: <zip>" before each archive then lines starting with "ERROR" (or "Open ERROR")
+    // the "Errors: N" summaries (Sub items, Archives with...) are for the whole batch: they don't tell which zip
+    QString currentZip;
+    for (const QByteArray &rawLine : output.split('\n'))
+    {
+        QString line = QString::fromLocal8Bit(rawLine).trimmed();
+        if (line.startsWith(sBatchArchiveLine))
+        {
+            currentZip = QFileInfo(line.mid(sBatchArchiveLine.size()).trimmed()).fileName();
+            continue;
+        }
+
+        if (!line.startsWith("ERROR") && !line.startsWith("Open ERROR"))
+            continue;
+
+        // "ERROR: <zip>" when 7z can't even open it
+        QString errorPath = QFileInfo(line.mid(line.indexOf(':') + 1).trimmed()).fileName();
+        for (const QFileInfo &zip : zips)
+        {
+            if (zip.fileName() == errorPath)
+                return zip;
+        }
+        for (const QFileInfo &zip : zips)
+        {
+            if (zip.fileName() == currentZip)
+                return zip;
+        }
+    }
+    return QFileInfo();
+}
+
+void FolderWorker::_deleteStagedZip(const QFileInfo &zip)
+{
+    if (_streaming || _app._staging == Ex0days::STAGING::NO_COPY)
+        return; // that's the source!
+    if (_movedZips.contains(zip))
+        return; // the source too: deleted once the folder is OK (or moved back by the rollback)
+
+    QFile file(zip.absoluteFilePath());
+    if (!file.remove())
+    {
+        qCritical() << "Error deleting " << zip.absoluteFilePath() << ": " << file.errorString();
+    }
+}
+
+void FolderWorker::_restoreMovedZips()
+{
+    for (const QFileInfo &zip : _movedZips)
+    {
+        QString srcPath = _srcDir->absoluteFilePath(zip.fileName());
+        if (!QFile::rename(zip.absoluteFilePath(), srcPath))
+            _app._error(tr("Error moving back %1 to %2").arg(zip.absoluteFilePath()).arg(srcPath));
+    }
+    _movedZips.clear();
+}
+
+void FolderWorker::_failExtract(const QString &reason)
+{
+    _report.setReason(reason);
+    _app._failExtract(_srcDir->absolutePath(), reason);
+}
+
+bool FolderWorker::_moveStagedFiles()
+{
+    if (_stagingReserved == 0)
+        return true;
+
+    for (const QFileInfo &fi : _unzippedFiles)
+    {
+        QString dstPath = QString("%1/%2").arg(_copyDirPath()).arg(fi.fileName());
+        if (QFile::rename(fi.absoluteFilePath(), dstPath))
+            continue;
+        if (FileCopier::copy(fi.absoluteFilePath(), dstPath, false) == FileCopier::STRATEGY::FAILED)
+            return false;
+        QFile::remove(fi.absoluteFilePath());
+    }
+    return true;
+}
+
+void FolderWorker::_clearStaging()
+{
+    if (_stagingReserved == 0)
+        return;
+
+    if (_workPath.startsWith(_app._stagingPath)) // not set if the folder failed before its copy
+    {
+        QDir workDir(_workPath);
+        if (!workDir.removeRecursively())
+            _app._error(tr("Error deleting staging directory: %1").arg(workDir.absolutePath()));
+
+        // remove the parents that are now empty
+        QDir stagingDir(_app._stagingPath);
+        QString path = _subPath();
+        while (path.contains('/'))
+        {
+            path = path.section('/', 0, -2);
+            if (!stagingDir.rmdir(path))
+                break;
+        }
+    }
+
+    _app._releaseStaging(_stagingReserved);
+    _stagingReserved = 0;
+}
+
+void FolderWorker::_clearDir()
+{
+    _clearStaging(); // before we forget the current path
+    if (_dstReserved)
+    {
+        _app._releaseDst(_dstReserved);
+        _dstReserved = 0;
+    }
+    _app._devices.release(_devices);
+    _devices.clear();
+    _state = STATE::IDLE;
+    if (_srcDir)
+    {
+        delete _srcDir;
+        _srcDir = nullptr;
+    }
+    _zipFiles.clear();
+    _movedZips.clear();
+    _unzipTasks.clear();
+    if (_streamer)
+        _streamer->clearMemoryFiles();
+    _streaming     = false;
+    _workPath.clear();
+    _unzipChunk    = 1;
+    _batchFallback = false;
+    _unzipFailed   = false;
+    _currentPath.clear();
+    _signature.clear();
+    _unzippedSize = 0;
+    _fistArchive = QFileInfo();
+    _archiveType = Ex0days::ARCHIVE_TYPE::UNKNOWN;
+    _unzippedFiles.clear();
+    _report = FolderReport();
+    _unzipStages.clear();
+    _extractStage = -1;
+}
+
+void FolderWorker::_abort()
+{
+    if (!_workPath.isEmpty())
+    {
+        // nothing must stay from a folder we haven't finished (it'll be processed again)
+        FolderJournal::rollback(_journalKey(), _copyDirPath(), _workPath, _app._staging == Ex0days::STAGING::MOVE);
+        _app._journal->setState(_journalKey(), FolderJournal::STATE::ROLLED_BACK);
+        if (_app._debug)
+            _app._log(tr("%1 rolled back").arg(_srcDir->absolutePath()));
+    }
+    if (_report.isStarted())
+    {
+        _report.setReason(tr("stopped"));
+        _report.finish(false, 0);
+        _app._writeReport(_report);
+    }
+    _clearDir();
+    emit folderStopped();
+}
+
+void FolderWorker::_goToNextFolder(bool success, bool delUnzippedFiles)
+{
+    int cleanupStage = _report.begin("cleanup");
+    if (success)
+    {
+        QStringList intermediateFiles;
+        if (delUnzippedFiles)
+        {
+            for (const QFileInfo & fi : _unzippedFiles)
+                intermediateFiles << fi.fileName();
+        }
+        for (const QFileInfo & zip : _movedZips)
+            intermediateFiles << zip.fileName();
+        _app._journal->extracted(_journalKey(), _app._delSrc, !_app._testOnly, intermediateFiles);
+        for (const QFileInfo & zip : _movedZips)
+            QFile::remove(zip.absoluteFilePath());
+    }
+    else
+        _restoreMovedZips(); // before the copy directory is deleted
+
+    if (_app._testOnly || !success)
+    {
+        QDir copyDir(_copyDirPath());
+        if (!copyDir.removeRecursively())
+            _app._error(tr("Error deleting copy directory: %1").arg(copyDir.absolutePath()));
+        else if (_app._debug)
+            _app._log(tr("Copy directory deleted: %1").arg(copyDir.absolutePath()));
+    }
+    else if (delUnzippedFiles)
+    {
+        for (const QFileInfo & fi : _unzippedFiles)
+            QFile::remove(fi.absoluteFilePath());
+    }
+
+    if (_app._delSrc)
+    {
+        if (!_srcDir->removeRecursively())
+            _app._error(tr("Error deleting source directory: %1").arg(_srcDir->absolutePath()));
+        else if (_app._debug)
+            _app._log(tr("Source directory deleted: %1").arg(_srcDir->absolutePath()));
+    }
+
+    _app._index->record(_srcDir->absolutePath(), _signature, success);
+    _app._journal->setState(_journalKey(), FolderJournal::STATE::CLEANED);
+    _report.end(cleanupStage);
+    qint64 outputSize = success && !_app._testOnly ? _outputSize() : 0;
+    _report.finish(success, outputSize);
+    _app._writeReport(_report);
+    _app._releaseDst(_dstReserved, outputSize); // the rest of the reservation is free again
+    _dstReserved = 0;
+    qint64 unzippedSize = _unzippedSize;
+    _clearDir();
+    emit folderDone(success, unzippedSize);
+}
+
+void FolderWorker::_endStage(int stageId, Extractor *extractor, int exitCode)
+{
+    Extractor::ProcessRun run = extractor->lastRun();
+    _report.setProcess(stageId, run.pid, run.program, run.start, run.end);
+    _report.end(stageId, exitCode);
+}
+
+qint64 FolderWorker::_outputSize() const
+{
+    // what the folder has produced (once the intermediate files are deleted)
+    qint64 size = 0;
+    QDirIterator it(_copyDirPath(), QDir::Files|QDir::Hidden|QDir::NoSymLinks, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        it.next();
+        size += it.fileInfo().size();
+    }
+    return size;
+}
+
+void FolderWorker::_doSecondExtract()
+{
+    _state = STATE::FINAL;
+    qDebug() << tr("Ready for Second Extract!");
+    _app._journal->setState(_journalKey(), FolderJournal::STATE::UNZIPPED);
+
+    QDir copyDir(_copyDirPath()), workDir(_workPath);
+    if (_streaming)
+    {
+        // the volumes are in memory, their paths are where they would have been unzipped
+        _unzippedFiles.clear();
+        for (const QString &fileName : _streamer->memoryFiles())
+            _unzippedFiles << QFileInfo(workDir.absoluteFilePath(fileName));
+    }
+    else
+    {
+        _unzippedFiles.clear();
+        for (const QFileInfo &file : workDir.entryInfoList(QDir::Files|QDir::Hidden|QDir::Readable|QDir::NoSymLinks, QDir::Name))
+        {
+            if (!_movedZips.contains(file)) // still there with --in-place
+                _unzippedFiles << file;
+        }
+    }
+    bool isFirstArchive = false, allUnknowArchives = true;
+    for (const QFileInfo &file : _unzippedFiles)
+    {
+        _findArchiveType(file, isFirstArchive);
+        if (_archiveType != Ex0days::ARCHIVE_TYPE::UNKNOWN)
+            allUnknowArchives = false;
+
+        if (isFirstArchive)
+        {
+            _fistArchive = file;
+            break;
+        }
+    }
+
+    if (isFirstArchive)
+    {
+        _report.setArchiveType(Ex0days::archiveTypeName(_archiveType));
+        if (_app._debug)
+            _app._log(tr("  - first archive found: %1").arg(_fistArchive.fileName()));
+        _app._journal->setState(_journalKey(), FolderJournal::STATE::SECOND_STAGE);
+        QFileInfoList volumes = _volumeSet();
+        qint64 volumesSize = 0;
+        for (const QFileInfo &volume : volumes)
+            volumesSize += volume.size(); // 0 in memory
+        _extractStage = _report.begin("extract", QString("%1 (%2)").arg(
+                                          _fistArchive.fileName()).arg(Ex0days::archiveTypeName(_archiveType)), volumesSize);
+        if (_streaming && (_archiveType == Ex0days::ARCHIVE_TYPE::RAR || _archiveType == Ex0days::ARCHIVE_TYPE::Z7))
+            _streamer->extract(_archiveType, volumes, copyDir.absolutePath());
+        else if (_streaming && !_streamer->writeMemoryFiles(copyDir.absolutePath()))
+        {
+            _failExtract(tr("error writing the unzipped files"));
+            _goToNextFolder(false);
+        }
+        else // libarchive can't read ACE and multi-volume ARJ: the external programs need the files
+            _extractor(_archiveType)->extract(_archiveType, volumes, copyDir.absolutePath());
+    }
+    else if (allUnknowArchives)
+    {
+        _report.setArchiveType("NONE");
+        _app._error(tr("%1 ?? (no second archives found)").arg(_srcDir->absolutePath()));
+        // the unzipped files are the payload
+        if (_streaming && !_app._testOnly && !_streamer->writeMemoryFiles(copyDir.absolutePath()))
+        {
+            _failExtract(tr("error writing the unzipped files"));
+            _goToNextFolder(false);
+        }
+        else if (!_app._testOnly && !_moveStagedFiles())
+        {
+            _failExtract(tr("error moving the unzipped files from the staging folder"));
+            _goToNextFolder(false);
+        }
+        else
+            _goToNextFolder(true, false);
+    }
+    else
+    {
+        _failExtract(tr("first archive is missing"));
+        _goToNextFolder(false);
+    }
+}
+
+void FolderWorker::_findArchiveType(const QFileInfo &file, bool &firstArchive)
+{
+    // the header decides, the name only breaks the ties (or is all we have if the file can't be read)
+    QByteArray header = _streaming ?
+                _streamer->memoryFileHeader(QDir(_workPath).relativeFilePath(file.absoluteFilePath()), ArchiveDetector::sPeekSize)
+              : ArchiveDetector::readHeader(file.absoluteFilePath());
+
+    ArchiveDetector::Detection byName = ArchiveDetector::detectName(file.fileName());
+    _archiveType   = byName.type;
+    bool nameFirst = byName.first == ArchiveDetector::FIRST::YES;
+    if (header.isEmpty())
+    {
+        firstArchive = nameFirst;
+        return;
+    }
+
+    ArchiveDetector::Detection detection = ArchiveDetector::detect(header);
+    if (detection.type == Ex0days::ARCHIVE_TYPE::UNKNOWN)
+        firstArchive = false; // a first volume always starts with its signature (not the next parts of a split 7z)
+    else
+    {
+        if (detection.first == ArchiveDetector::FIRST::UNKNOWN)
+            firstArchive = detection.type == _archiveType ? nameFirst : true; // misnamed: we can't do better
+        else
+            firstArchive = detection.first == ArchiveDetector::FIRST::YES;
+        if (_app._debug && detection.type != _archiveType)
+            _app._log(tr("  - %1 is a %2 archive").arg(file.fileName()).arg(Ex0days::archiveTypeName(detection.type)));
+        _archiveType = detection.type;
+    }
+
+#ifdef __DEBUG__
+    qDebug() << file << " is " << Ex0days::archiveTypeName(_archiveType) << " (first: " << firstArchive << ")";
+#endif
+}
+
+QFileInfoList FolderWorker::_volumeSet() const
+{
+    // the first archive then the other volumes sharing its base name (name.partXX.rar, name.rXX, name.7z.XXX...)
+    QString firstName = _fistArchive.fileName();
+    QStringRef baseName = firstName.leftRef(ArchiveDetector::detectName(firstName).baseSize);
+
+    // ordered by volume number as the names don't sort (name.part1.rar, name.part10.rar, name.part2.rar)
+    QMap<int, QFileInfoList> otherVolumes;
+    for (const QFileInfo &file : _unzippedFiles)
+    {
+        QString fileName = file.fileName();
+        if (fileName == firstName)
+            continue;
+        ArchiveDetector::Detection detection = ArchiveDetector::detectName(fileName);
+        if (detection.volume >= 0 && fileName.leftRef(detection.baseSize).compare(baseName, Qt::CaseInsensitive) == 0)
+            otherVolumes[detection.volume] << file;
+    }
+
+    QFileInfoList volumes = {_fistArchive};
+    for (const QFileInfoList &files : otherVolumes)
+        volumes << files;
+    return volumes;
+}
@@ -0,0 +1,141 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef FOLDERWORKER_H
+#define FOLDERWORKER_H
+#include "Ex0days.h"
+#include "FolderReport.h"
+class Extractor;
+
+/*!
+ * \brief The FolderWorker class runs the whole extraction pipeline of one 0day folder at a time
+ * (copy of the zips, unzip of each of them then extraction of the second archive)
+ * Ex0days owns several of them to process folders concurrently (cf --jobs)
+ * Everything happens in the main thread: each worker only owns its Extractors
+ * (external processes or in-process jobs, cf --inproc)
+ */
+class FolderWorker : public QObject
+{
+    Q_OBJECT
+
+private:
+    enum class STATE : char {IDLE = 0, UNZIP, FINAL};
+
+    Ex0days              &_app;  //!< main app (settings, logs, counters)
+    const int             _id;   //!< worker slot
+
+    STATE                 _state;
+    QMap<Ex0days::ARCHIVE_TYPE, Extractor*> _extractors; //!< the ones of the folder slot (created on demand)
+    Extractor            *_streamer;  //!< in-memory extractor used for both stages (--stream)
+    bool                  _streaming; //!< the zips of the current folder are unzipped in memory
+    QString               _workPath;  //!< where the intermediate files go (output or staging folder)
+    qint64                _stagingReserved; //!< bytes reserved in the staging budget (--staging)
+    qint64                _dstReserved;     //!< bytes reserved in the output (cf Ex0days::_reserveFolder)
+    QList<quint64>        _devices;         //!< acquired in the DeviceScheduler for the folder
+    QDir                 *_srcDir;
+    QStringList           _currentPath;
+    QByteArray            _signature; //!< of the zips for the index (computed before they move)
+    qint64                _unzippedSize; //!< estimated by the FolderEntry (for the progress)
+    QQueue<QFileInfo>     _zipFiles;
+    QFileInfoList         _movedZips; //!< --in-place: the only copy of the zips, kept until the folder is OK
+    QMap<Extractor*, QFileInfoList> _unzipTasks; //!< running unzips of the first stage with their zips
+    QList<Extractor*>     _unzipExtractors; //!< extra ones to unzip in parallel (--unzip-jobs)
+    int                   _unzipChunk;    //!< number of zips per 7z (more than one with --batch-unzip)
+    bool                  _batchFallback; //!< a batch failed without telling which zip: one 7z per zip
+    bool                  _unzipFailed;   //!< a zip is broken, we're waiting for the siblings to stop
+    QFileInfo             _fistArchive;
+    Ex0days::ARCHIVE_TYPE _archiveType;
+    QFileInfoList         _unzippedFiles;
+    FolderReport          _report;       //!< timings of the current folder (JSON Lines report)
+    QHash<Extractor*, int> _unzipStages; //!< report stage of each running unzip
+    int                   _extractStage; //!< report stage of the second extraction
+
+public:
+    FolderWorker(Ex0days &app, int id);
+    ~FolderWorker() override;
+
+    inline int id() const;
+    inline bool isIdle() const;
+
+    //! with the space reserved by Ex0days in the output and the staging folder (0: the volumes go in the output)
+    void processFolder(const FolderEntry &entry, qint64 dstReserved, qint64 stagingReserved);
+    void stop();
+
+signals:
+    void unzipNext();
+    void folderDone(bool success, qint64 unzippedSize); //!< emitted once the folder is cleaned (queued to the app)
+    void folderStopped();          //!< emitted when the folder has been aborted by stopProcessing
+
+public slots:
+    void onUnzipNextFile();
+
+private:
+    Extractor *_extractor(Ex0days::ARCHIVE_TYPE type);
+    Extractor *_newExtractor(Ex0days::ARCHIVE_TYPE type, bool inMemory = false);
+    Extractor *_streamExtractor();
+    Extractor *_availableUnzipExtractor();
+    void _onExtractorFinished(Extractor *extractor, int exitCode);
+    void _onUnzipFinished(Extractor *extractor, int exitCode);
+    void _terminateUnzips();
+    QFileInfo _failedZipOfBatch(const QFileInfoList &zips, const QByteArray &output) const;
+    void _deleteStagedZip(const QFileInfo &zip);
+    void _restoreMovedZips();
+
+    QString _preflight(const QList<ZipIndex> &indexes) const; //!< what's wrong with the zips (empty if nothing)
+    void _failExtract(const QString &reason);
+    bool _moveStagedFiles();
+    void _clearStaging();
+    void _clearDir();
+    void _doSecondExtract();
+    void _abort();
+
+    inline QString _subPath() const;
+    inline QString _copyDirPath() const;
+    inline QString _journalKey() const;
+
+    void _findArchiveType(const QFileInfo &file, bool &firstArchive);
+    QFileInfoList _volumeSet() const;
+
+    void _goToNextFolder(bool success, bool delUnzippedFiles = true);
+    qint64 _outputSize() const;
+    void _endStage(int stageId, Extractor *extractor, int exitCode);
+
+    static const QString sBatchArchiveLine;
+};
+
+int FolderWorker::id() const { return _id; }
+bool FolderWorker::isIdle() const { return _state == STATE::IDLE && !_srcDir; }
+
+QString FolderWorker::_subPath() const
+{
+    QStringList subPath(_currentPath);
+    subPath.removeFirst();
+    return subPath.join("/");
+}
+
+QString FolderWorker::_journalKey() const { return _currentPath.join("/"); }
+
+QString FolderWorker::_copyDirPath() const
+{
+    return QString("%1/%2").arg(_app._dstDir->absolutePath()).arg(_subPath());
+}
+
+#endif // FOLDERWORKER_H
@@ -0,0 +1,118 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "JobController.h"
+#include <QCoreApplication>
+#include <cmath>
+
+JobController::JobController():
+    _minJobs(1), _maxJobs(1), _limit(1),
+    _lastMs(0), _lastBytes(0), _lastFolders(0),
+    _lastRate(-1.), _rateInBytes(true), _nbHolds(0)
+{}
+
+void JobController::start(int minJobs, int maxJobs, qint64 nowMs)
+{
+    _minJobs     = minJobs;
+    _maxJobs     = qMax(minJobs, maxJobs);
+    _limit       = _minJobs;
+    _lastMs      = nowMs;
+    _lastBytes   = 0;
+    _lastFolders = 0;
+    _lastRate    = -1.;
+    _nbHolds     = 0;
+}
+
+bool JobController::sample(qint64 bytesDone, uint foldersDone, qint64 nowMs, bool canGrow, QString &reason)
+{
+    qint64 elapsed = nowMs - _lastMs;
+    if (elapsed < sWindowMs || foldersDone == _lastFolders)
+        return false; // too short to be meaningful
+
+    bool   inBytes = bytesDone > _lastBytes;
+    double rate    = 1000. * (inBytes ? bytesDone - _lastBytes : foldersDone - _lastFolders) / elapsed;
+    double lastRate = inBytes == _rateInBytes ? _lastRate : -1.;
+    _lastMs      = nowMs;
+    _lastBytes   = bytesDone;
+    _lastFolders = foldersDone;
+    _lastRate    = rate;
+    _rateInBytes = inBytes;
+
+    if (!canGrow)
+    {
+        // the end of the queue: fewer folders are running whatever the limit
+        _lastRate = -1.;
+        return false;
+    }
+
+    int limit = _limit;
+    if (lastRate < 0.)
+    {
+        ++limit; // first window: probe
+        reason = QCoreApplication::translate("JobController", "first window at %1").arg(_rateStr(rate, inBytes));
+    }
+    else if (rate >= lastRate * (1. + sGain))
+    {
+        ++limit;
+        reason = QCoreApplication::translate("JobController", "throughput up: %1 (was %2)").arg(
+                     _rateStr(rate, inBytes)).arg(_rateStr(lastRate, inBytes));
+    }
+    else if (rate <= lastRate * (1. - sLoss))
+    {
+        limit = static_cast<int>(std::floor(_limit * sDecrease));
+        reason = QCoreApplication::translate("JobController", "throughput down: %1 (was %2)").arg(
+                     _rateStr(rate, inBytes)).arg(_rateStr(lastRate, inBytes));
+    }
+    else if (++_nbHolds >= sHoldWindows)
+    {
+        ++limit; // the load may have changed since we settled
+        reason = QCoreApplication::translate("JobController", "probing after %1 stable windows at %2").arg(
+                     _nbHolds).arg(_rateStr(rate, inBytes));
+    }
+    else
+        reason = QCoreApplication::translate("JobController", "throughput stable: %1 (was %2)").arg(
+                     _rateStr(rate, inBytes)).arg(_rateStr(lastRate, inBytes));
+
+    if (_setLimit(limit))
+    {
+        _nbHolds = 0;
+        return true;
+    }
+    return false;
+}
+
+bool JobController::_setLimit(int limit)
+{
+    limit = qBound(_minJobs, limit, _maxJobs);
+    if (limit == _limit)
+        return false;
+
+    _limit = limit;
+    return true;
+}
+
+QString JobController::_rateStr(double rate, bool inBytes)
+{
+    if (inBytes)
+        return QString("%1 MB/s").arg(rate / 1024 / 1024, 0, 'f', 1);
+    return QString("%1 folders/min").arg(rate * 60, 0, 'f', 1);
+}
@@ -0,0 +1,77 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef JOBCONTROLLER_H
+#define JOBCONTROLLER_H
+#include <QString>
+
+/*!
+ * \brief The JobController class adapts the number of folders processed concurrently
+ * to the measured throughput (--adaptive) with an AIMD controller:
+ *  - the throughput (unzipped bytes/sec, folders/sec if the zips are not indexed)
+ *    is sampled over windows of at least sWindowMs, on the folder completions
+ *  - one more folder while it increases (additive increase)
+ *  - the limit is cut by sDecrease when it drops (multiplicative decrease)
+ *  - it is held on a plateau and probed again after sHoldWindows windows
+ * The limit stays between 1 and --jobs (the number of workers)
+ */
+class JobController
+{
+private:
+    int     _minJobs;
+    int     _maxJobs;
+    int     _limit;        //!< folders that can run at once
+    qint64  _lastMs;       //!< start of the current window
+    qint64  _lastBytes;
+    uint    _lastFolders;
+    double  _lastRate;     //!< throughput of the previous window (< 0 before the first one)
+    bool    _rateInBytes;  //!< _lastRate is in bytes/sec (otherwise folders/sec)
+    int     _nbHolds;      //!< consecutive windows without any change
+
+public:
+    JobController();
+
+    void start(int minJobs, int maxJobs, qint64 nowMs);
+    inline int limit() const;
+
+    /*!
+     * \brief sample closes the current window if it is long enough
+     * \param canGrow  some folders are waiting (otherwise the throughput is bounded by the queue)
+     * \param reason   why the limit has changed (for the logs)
+     * \return true if the limit has changed
+     */
+    bool sample(qint64 bytesDone, uint foldersDone, qint64 nowMs, bool canGrow, QString &reason);
+
+    static constexpr qint64 sWindowMs     = 10000;
+    static constexpr double sGain         = 0.05; //!< min relative increase to add a folder
+    static constexpr double sLoss         = 0.10; //!< min relative drop to cut the limit
+    static constexpr double sDecrease     = 0.75;
+    static constexpr int    sHoldWindows  = 3;
+
+private:
+    bool _setLimit(int limit);
+    static QString _rateStr(double rate, bool inBytes);
+};
+
+int JobController::limit() const { return _limit; }
+
+#endif // JOBCONTROLLER_H
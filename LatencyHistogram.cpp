@@ -0,0 +1,98 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "LatencyHistogram.h"
+#include <QJsonObject>
+#include <QString>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram():
+    _counts(), _count(0), _min(0), _max(0), _sum(0.)
+{}
+
+void LatencyHistogram::record(qint64 value)
+{
+    value = qMax<qint64>(0, value);
+    int bucket = _bucket(value);
+    if (bucket >= _counts.size())
+        _counts.resize(bucket + 1);
+    ++_counts[bucket];
+
+    _min  = _count ? qMin(_min, value) : value;
+    _max  = _count ? qMax(_max, value) : value;
+    _sum += value;
+    ++_count;
+}
+
+qint64 LatencyHistogram::percentile(double percent) const
+{
+    if (_count == 0)
+        return 0;
+
+    quint64 rank = qMax<quint64>(1, static_cast<quint64>(std::ceil(percent / 100. * _count)));
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < _counts.size(); ++bucket)
+    {
+        seen += _counts.at(bucket);
+        if (seen >= rank)
+            return qMin(_highestValue(bucket), _max);
+    }
+    return _max;
+}
+
+QJsonObject LatencyHistogram::toJson() const
+{
+    return QJsonObject{{"count", static_cast<qint64>(_count)}, {"min", _min},
+                       {"p50", percentile(50)}, {"p90", percentile(90)}, {"p99", percentile(99)},
+                       {"max", _max}, {"mean", mean()}};
+}
+
+QString LatencyHistogram::toString() const
+{
+    return QString("p50 %1, p90 %2, p99 %3, max %4").arg(
+                percentile(50)).arg(percentile(90)).arg(percentile(99)).arg(_max);
+}
+
+int LatencyHistogram::_bucket(qint64 value)
+{
+    // exact values then half as many buckets as values per power of two
+    constexpr qint64 exact = 1LL << sSubBucketBits, half = exact / 2;
+    if (value < exact)
+        return static_cast<int>(value);
+
+    int shift = 1;
+    while ((value >> shift) >= exact)
+        ++shift;
+    return static_cast<int>(exact + (shift - 1) * half + ((value >> shift) - half));
+}
+
+qint64 LatencyHistogram::_highestValue(int bucket)
+{
+    constexpr qint64 exact = 1LL << sSubBucketBits, half = exact / 2;
+    if (bucket < exact)
+        return bucket;
+
+    qint64 index = bucket - exact;
+    int    shift = static_cast<int>(index / half) + 1;
+    qint64 lower = (index % half + half) << shift;
+    return lower + (1LL << shift) - 1;
+}
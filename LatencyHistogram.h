@@ -0,0 +1,69 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+#include <QVector>
+class QJsonObject;
+
+/*!
+ * \brief The LatencyHistogram class counts positive values in log-linear buckets (like HdrHistogram):
+ * exact below 2^sSubBucketBits then 2^(sSubBucketBits-1) buckets per power of two,
+ * so any percentile is known within 2% whatever the range (ms to hours, KB/s to GB/s)
+ * with a few hundred counters and no sample kept
+ */
+class LatencyHistogram
+{
+private:
+    QVector<quint64> _counts;
+    quint64          _count;
+    qint64           _min;
+    qint64           _max;
+    double           _sum;
+
+public:
+    LatencyHistogram();
+
+    void record(qint64 value); //!< negative values count as 0
+
+    inline quint64 count() const;
+    inline qint64  min() const;
+    inline qint64  max() const;
+    inline double  mean() const;
+    qint64 percentile(double percent) const; //!< highest value of the bucket (bounded by max)
+
+    QJsonObject toJson() const; //!< count, min, p50, p90, p99, max, mean
+    QString toString() const;   //!< p50, p90, p99, max
+
+    static constexpr int sSubBucketBits = 7;
+
+private:
+    static int    _bucket(qint64 value);
+    static qint64 _highestValue(int bucket);
+};
+
+quint64 LatencyHistogram::count() const { return _count; }
+qint64  LatencyHistogram::min()   const { return _min; }
+qint64  LatencyHistogram::max()   const { return _max; }
+double  LatencyHistogram::mean()  const { return _count ? _sum / _count : 0.; }
+
+#endif // LATENCYHISTOGRAM_H
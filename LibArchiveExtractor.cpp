@@ -0,0 +1,481 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "LibArchiveExtractor.h"
+#include <QRunnable>
+#include <QVector>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+#include <archive.h>
+#include <archive_entry.h>
+
+namespace {
+
+//! a volume unzipped in memory, read by libarchive through the callbacks below
+struct MemoryVolume
+{
+    QByteArray data;
+    la_int64_t pos;
+};
+
+la_ssize_t memoryRead(struct archive *, void *clientData, const void **buffer)
+{
+    MemoryVolume *volume = static_cast<MemoryVolume*>(clientData);
+    *buffer = volume->data.constData() + volume->pos;
+    la_ssize_t size = volume->data.size() - volume->pos;
+    volume->pos = volume->data.size();
+    return size;
+}
+
+la_int64_t memorySkip(struct archive *, void *clientData, la_int64_t request)
+{
+    MemoryVolume *volume = static_cast<MemoryVolume*>(clientData);
+    la_int64_t skipped = qMin(request, volume->data.size() - volume->pos);
+    volume->pos += skipped;
+    return skipped;
+}
+
+la_int64_t memorySeek(struct archive *, void *clientData, la_int64_t offset, int whence)
+{
+    MemoryVolume *volume = static_cast<MemoryVolume*>(clientData);
+    la_int64_t pos = offset;
+    if (whence == SEEK_CUR)
+        pos += volume->pos;
+    else if (whence == SEEK_END)
+        pos += volume->data.size();
+    if (pos < 0 || pos > volume->data.size())
+        return ARCHIVE_FATAL;
+    volume->pos = pos;
+    return pos;
+}
+
+int memorySwitch(struct archive *, void *, void *nextClientData)
+{
+    if (nextClientData)
+        static_cast<MemoryVolume*>(nextClientData)->pos = 0;
+    return ARCHIVE_OK;
+}
+
+} // namespace
+
+/*!
+ * \brief The LibArchiveJob class is the extraction itself, run by the thread pool
+ * independent zips are extracted one after the other,
+ * a volume set is read as one single stream (first volume first)
+ */
+class LibArchiveJob : public QRunnable
+{
+private:
+    LibArchiveExtractor &_extractor;
+    const bool           _volumeSet;
+    const bool           _testOnly;   //!< read the second stage without writing anything
+    QList<QByteArray>    _archives;   //!< paths on disk or keys of the memory files
+    const QByteArray     _outputDir;
+    QByteArray           _output;
+
+public:
+    LibArchiveJob(LibArchiveExtractor &extractor, bool volumeSet, bool testOnly,
+                  const QFileInfoList &archives, const QString &outputDir):
+        QRunnable(),
+        _extractor(extractor), _volumeSet(volumeSet), _testOnly(volumeSet && testOnly), _archives(),
+        _outputDir(QFile::encodeName(outputDir)), _output()
+    {
+        QDir dir(outputDir);
+        for (const QFileInfo &fi : archives)
+        {
+            if (_volumeSet && _extractor._inMemory)
+                _archives << QFile::encodeName(dir.relativeFilePath(fi.absoluteFilePath()));
+            else
+                _archives << QFile::encodeName(fi.absoluteFilePath());
+        }
+    }
+
+    void run() override
+    {
+        int exitCode = 0;
+        if (_volumeSet)
+        {
+            _output += "Extracting archive: " + _archives.first() + "\n";
+            QVector<MemoryVolume> volumes; // must live as long as the reader
+            struct archive *reader = nullptr;
+            if (_extractor._inMemory)
+            {
+                for (const QByteArray &archive : _archives)
+                    volumes << MemoryVolume{_extractor._memoryFiles.value(QFile::decodeName(archive)), 0};
+                reader = _openMemory(volumes);
+            }
+            else
+                reader = _openFiles(_archives);
+
+            exitCode = _testOnly ? _test(reader, _archives.first()) : _extract(reader, _archives.first());
+        }
+        else
+        {
+            for (const QByteArray &archive : _archives)
+            {
+                _output += "Extracting archive: " + archive + "\n";
+                if (_extractor._inMemory)
+                    exitCode = _unzipInMemory(_openFiles({archive}), archive);
+                else
+                    exitCode = _extract(_openFiles({archive}), archive);
+                if (exitCode != 0)
+                    break;
+            }
+        }
+
+        QMetaObject::invokeMethod(&_extractor, "onJobDone", Qt::QueuedConnection,
+                                  Q_ARG(int, exitCode), Q_ARG(QByteArray, _output));
+        QMutexLocker lock(&_extractor._jobMutex);
+        _extractor._jobAlive = false; // nothing to touch anymore
+        _extractor._jobDone.wakeAll();
+    }
+
+private:
+    struct archive *_newReader()
+    {
+        struct archive *reader = archive_read_new();
+        archive_read_support_filter_all(reader);
+        archive_read_support_format_all(reader);
+        return reader;
+    }
+
+    struct archive *_openFiles(const QList<QByteArray> &volumes)
+    {
+        QVector<const char*> fileNames;
+        for (const QByteArray &volume : volumes)
+            fileNames << volume.constData();
+        fileNames << nullptr;
+
+        struct archive *reader = _newReader();
+        if (archive_read_open_filenames(reader, fileNames.data(), sBlockSize) != ARCHIVE_OK)
+        {
+            _error(reader, volumes.first());
+            archive_read_free(reader);
+            return nullptr;
+        }
+        return reader;
+    }
+
+    //! the volumes must live until the reader is freed
+    struct archive *_openMemory(QVector<MemoryVolume> &volumes)
+    {
+        struct archive *reader = _newReader();
+        archive_read_set_read_callback(reader, memoryRead);
+        archive_read_set_skip_callback(reader, memorySkip);
+        archive_read_set_seek_callback(reader, memorySeek);
+        archive_read_set_switch_callback(reader, memorySwitch);
+        for (MemoryVolume &volume : volumes)
+            archive_read_append_callback_data(reader, &volume);
+        if (archive_read_open1(reader) != ARCHIVE_OK)
+        {
+            _error(reader, _archives.first());
+            archive_read_free(reader);
+            return nullptr;
+        }
+        return reader;
+    }
+
+    int _extract(struct archive *reader, const QByteArray &name)
+    {
+        if (!reader)
+            return LibArchiveExtractor::sExitError;
+
+        struct archive *writer = archive_write_disk_new();
+        archive_write_disk_set_options(writer, ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM
+                                       | ARCHIVE_EXTRACT_SECURE_NODOTDOT | ARCHIVE_EXTRACT_SECURE_SYMLINKS);
+        archive_write_disk_set_standard_lookup(writer);
+
+        int exitCode = 0;
+        struct archive_entry *entry = nullptr;
+        while (exitCode == 0)
+        {
+            exitCode = _nextHeader(reader, &entry, name);
+            if (!entry)
+                break;
+
+            // the threads share the working directory: we prefix the paths with the output
+            QByteArray path(archive_entry_pathname(entry));
+            if (path.isEmpty() || path.startsWith('/'))
+            {
+                _output += "ERROR: " + path + "\nUnsafe path in archive\n";
+                exitCode = LibArchiveExtractor::sExitError;
+                break;
+            }
+            archive_entry_set_pathname(entry, QByteArray(_outputDir + "/" + path).constData());
+            const char *hardlink = archive_entry_hardlink(entry);
+            if (hardlink)
+                archive_entry_set_hardlink(entry, QByteArray(_outputDir + "/" + hardlink).constData());
+
+            if (archive_write_header(writer, entry) < ARCHIVE_WARN)
+                exitCode = _error(writer, path);
+            else if (_hasData(entry))
+                exitCode = _copyData(reader, writer, path);
+
+            if (exitCode == 0 && archive_write_finish_entry(writer) < ARCHIVE_WARN)
+                exitCode = _error(writer, path);
+        }
+
+        archive_read_free(reader);
+        archive_write_free(writer);
+        return exitCode;
+    }
+
+    //! streamed entries (and some of the rar and 7z ones) don't know their size
+    static bool _hasData(struct archive_entry *entry)
+    {
+        return !archive_entry_size_is_set(entry) || archive_entry_size(entry) > 0;
+    }
+
+    //! read all the entries (so their CRCs are checked) without writing anything
+    int _test(struct archive *reader, const QByteArray &name)
+    {
+        if (!reader)
+            return LibArchiveExtractor::sExitError;
+
+        int exitCode = 0;
+        struct archive_entry *entry = nullptr;
+        while (exitCode == 0)
+        {
+            exitCode = _nextHeader(reader, &entry, name);
+            if (!entry)
+                break;
+            if (_hasData(entry))
+                exitCode = _copyData(reader, nullptr, QByteArray(archive_entry_pathname(entry)));
+        }
+
+        archive_read_free(reader);
+        return exitCode;
+    }
+
+    //! keep the files of the zip in memory for the second stage
+    int _unzipInMemory(struct archive *reader, const QByteArray &name)
+    {
+        if (!reader)
+            return LibArchiveExtractor::sExitError;
+
+        int exitCode = 0;
+        struct archive_entry *entry = nullptr;
+        while (exitCode == 0)
+        {
+            exitCode = _nextHeader(reader, &entry, name);
+            if (!entry)
+                break;
+            if (archive_entry_filetype(entry) != AE_IFREG)
+                continue;
+
+            QByteArray path(archive_entry_pathname(entry));
+            QByteArray data;
+            if (archive_entry_size_is_set(entry))
+            {
+                if (archive_entry_size(entry) > sMaxMemoryFileSize)
+                {
+                    _output += "ERROR: " + path + "\nToo big to be kept in memory\n";
+                    exitCode = LibArchiveExtractor::sExitError;
+                    break;
+                }
+                data.reserve(static_cast<int>(archive_entry_size(entry)));
+            }
+
+            const void *buffer = nullptr;
+            size_t      size   = 0;
+            la_int64_t  offset = 0;
+            for (;;)
+            {
+                if (_extractor._abort.load())
+                {
+                    exitCode = LibArchiveExtractor::sExitStopped;
+                    break;
+                }
+
+                int res = archive_read_data_block(reader, &buffer, &size, &offset);
+                if (res == ARCHIVE_EOF)
+                    break;
+                else if (res != ARCHIVE_OK) // the bad CRCs are only warnings
+                {
+                    exitCode = _error(reader, name);
+                    break;
+                }
+                else if (offset + static_cast<la_int64_t>(size) > sMaxMemoryFileSize)
+                {
+                    _output += "ERROR: " + path + "\nToo big to be kept in memory\n";
+                    exitCode = LibArchiveExtractor::sExitError;
+                    break;
+                }
+
+                if (offset > data.size())
+                    data.append(QByteArray(static_cast<int>(offset) - data.size(), '\0')); // sparse
+                data.append(static_cast<const char*>(buffer), static_cast<int>(size));
+            }
+            if (exitCode == 0)
+                _extractor._memoryFiles.insert(QFile::decodeName(path), data);
+        }
+
+        archive_read_free(reader);
+        return exitCode;
+    }
+
+    //! entry is null at the end of the archive or on error
+    int _nextHeader(struct archive *reader, struct archive_entry **entry, const QByteArray &name)
+    {
+        if (_extractor._abort.load())
+        {
+            *entry = nullptr;
+            return LibArchiveExtractor::sExitStopped;
+        }
+
+        int res = archive_read_next_header(reader, entry);
+        if (res == ARCHIVE_EOF)
+        {
+            *entry = nullptr;
+            return 0;
+        }
+        else if (res < ARCHIVE_WARN)
+        {
+            *entry = nullptr;
+            return _error(reader, name);
+        }
+        return 0;
+    }
+
+    //! without writer the data is discarded (test)
+    int _copyData(struct archive *reader, struct archive *writer, const QByteArray &path)
+    {
+        const void *buffer = nullptr;
+        size_t      size   = 0;
+        la_int64_t  offset = 0;
+        for (;;)
+        {
+            if (_extractor._abort.load())
+                return LibArchiveExtractor::sExitStopped;
+
+            int res = archive_read_data_block(reader, &buffer, &size, &offset);
+            if (res == ARCHIVE_EOF)
+                return 0;
+            else if (res != ARCHIVE_OK) // the bad CRCs are only warnings
+                return _error(reader, path);
+
+            if (writer && archive_write_data_block(writer, buffer, size, offset) < ARCHIVE_WARN)
+                return _error(writer, path);
+        }
+    }
+
+    //! same format as 7z so FolderWorker can find the broken zip of a batch
+    int _error(struct archive *a, const QByteArray &name)
+    {
+        const char *msg = archive_error_string(a);
+        _output += "ERROR: " + name + "\n" + (msg ? msg : "unknown error") + "\n";
+        return LibArchiveExtractor::sExitError;
+    }
+
+    static constexpr size_t     sBlockSize         = 1024*1024;
+    static constexpr la_int64_t sMaxMemoryFileSize = 0x7fffffff; //!< QByteArray limit
+};
+
+
+LibArchiveExtractor::LibArchiveExtractor(Ex0days &app, bool inMemory, QObject *parent):
+    Extractor(app, parent),
+    _abort(0), _jobMutex(), _jobDone(), _jobAlive(false), _running(false), _output(),
+    _inMemory(inMemory), _memoryFiles()
+{}
+
+LibArchiveExtractor::~LibArchiveExtractor()
+{
+    // the pending onJobDone event is dropped with the object
+    _abort.store(1);
+    QMutexLocker lock(&_jobMutex);
+    while (_jobAlive)
+        _jobDone.wait(&_jobMutex); // the job stops at its next data block
+}
+
+void LibArchiveExtractor::extract(Ex0days::ARCHIVE_TYPE type, const QFileInfoList &archives, const QString &outputDir)
+{
+    qDebug() << "libarchive " << Ex0days::archiveTypeName(type) << ": " << archives.first().absoluteFilePath()
+             << " (" << archives.size() << " files) in " << outputDir;
+    _abort.store(0);
+    {
+        QMutexLocker lock(&_jobMutex);
+        _jobAlive = true;
+    }
+    _running = true;
+    _output.clear();
+    if (_inMemory && type == Ex0days::ARCHIVE_TYPE::ZIP)
+        _memoryFiles.clear();
+    _app._extractPool.start(new LibArchiveJob(*this, type != Ex0days::ARCHIVE_TYPE::ZIP, _app._testOnly, archives, outputDir));
+}
+
+void LibArchiveExtractor::terminate()
+{
+    if (_running)
+        _abort.store(1);
+}
+
+bool LibArchiveExtractor::isRunning() const
+{
+    return _running;
+}
+
+QByteArray LibArchiveExtractor::readOutput()
+{
+    QByteArray output;
+    output.swap(_output);
+    return output;
+}
+
+void LibArchiveExtractor::onJobDone(int exitCode, const QByteArray &output)
+{
+    _running = false;
+    _output  = output;
+    emit finished(exitCode);
+}
+
+QStringList LibArchiveExtractor::memoryFiles() const
+{
+    return _memoryFiles.keys();
+}
+
+QByteArray LibArchiveExtractor::memoryFileHeader(const QString &fileName, int size) const
+{
+    return _memoryFiles.value(fileName).left(size);
+}
+
+bool LibArchiveExtractor::writeMemoryFiles(const QString &outputDir)
+{
+    QDir dir(outputDir);
+    for (auto it = _memoryFiles.cbegin(), itEnd = _memoryFiles.cend(); it != itEnd; ++it)
+    {
+        QFile file(dir.absoluteFilePath(it.key()));
+        if (!dir.mkpath(QFileInfo(file.fileName()).absolutePath()) || !file.open(QIODevice::WriteOnly)
+                || file.write(it.value()) != it.value().size())
+        {
+            qCritical() << "Error writing " << file.fileName() << ": " << file.errorString();
+            return false;
+        }
+    }
+    return true;
+}
+
+void LibArchiveExtractor::clearMemoryFiles()
+{
+    if (!_running)
+        _memoryFiles.clear();
+}
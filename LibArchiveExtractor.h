@@ -0,0 +1,79 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef LIBARCHIVEEXTRACTOR_H
+#define LIBARCHIVEEXTRACTOR_H
+#include "Extractor.h"
+#include <QAtomicInt>
+#include <QMap>
+#include <QMutex>
+#include <QWaitCondition>
+
+/*!
+ * \brief The LibArchiveExtractor class extracts the archives in process with libarchive
+ * the extraction runs on the thread pool of Ex0days, the result comes back in the main thread
+ * Errors are reported like 7z would do ("ERROR: ..." lines, exit code 2, 255 when stopped)
+ * so the CSV is the same whatever the backend
+ *
+ * In memory mode (--stream) the zips are unzipped in _memoryFiles
+ * and the second stage reads its volume set from there: the intermediate volumes never touch the disk
+ * In test mode the second stage only reads the data (CRC checks) and writes nothing
+ */
+class LibArchiveExtractor : public Extractor
+{
+    Q_OBJECT
+
+private:
+    QAtomicInt     _abort;    //!< set by terminate, polled by the job between data blocks
+    QMutex         _jobMutex;
+    QWaitCondition _jobDone;  //!< for the destructor
+    bool           _jobAlive; //!< the job is still using this object (guarded by _jobMutex)
+    bool           _running;
+    QByteArray     _output;
+    const bool     _inMemory;
+    QMap<QString, QByteArray> _memoryFiles; //!< only touched by the job while _running
+
+public:
+    explicit LibArchiveExtractor(Ex0days &app, bool inMemory = false, QObject *parent = nullptr);
+    ~LibArchiveExtractor() override;
+
+    void extract(Ex0days::ARCHIVE_TYPE type, const QFileInfoList &archives, const QString &outputDir) override;
+    void terminate() override;
+    bool isRunning() const override;
+    QByteArray readOutput() override;
+
+    QStringList memoryFiles() const override;
+    QByteArray memoryFileHeader(const QString &fileName, int size) const override;
+    bool writeMemoryFiles(const QString &outputDir) override;
+    void clearMemoryFiles() override;
+
+private slots:
+    void onJobDone(int exitCode, const QByteArray &output);
+
+private:
+    friend class LibArchiveJob;
+
+    static constexpr int sExitError   = 2;   //!< 7z "Fatal error"
+    static constexpr int sExitStopped = 255; //!< 7z "User stopped the process"
+};
+
+#endif // LIBARCHIVEEXTRACTOR_H
@@ -104,6 +104,9 @@ void MainWindow::init(Ex0days *app)
     _ui->dispCompressionCB->setChecked(_app->dispPaths());
     onDispCompressionPaths(_app->dispPaths());
 
+    _ui->jobsSB->setRange(1, Ex0days::sMaxJobs);
+    _ui->jobsSB->setValue(_app->nbJobs());
+
 
 #ifdef __DEBUG__
 //    _ui->srcList->addPath("/tmp/ahbaz/1999.01.01", true);
@@ -126,6 +129,11 @@ void MainWindow::setProgressMax(int max)
     _progressBar->setValue(0);
 }
 
+void MainWindow::updateProgressMax(int max)
+{
+    _progressBar->setMaximum(max);
+}
+
 void MainWindow::setProgress(int value)
 {
     _progressBar->setValue(value);
@@ -156,6 +164,7 @@ void MainWindow::saveParams()
     _app->setDstFolder(_ui->dstLE->text());
     _app->setOptions(_ui->testOnlyCB->isChecked(), _ui->delSrcCB->isChecked(),
                      _ui->debugCB->isChecked(), _ui->dispCompressionCB->isChecked());
+    _app->setNbJobs(_ui->jobsSB->value());
 }
 
 void MainWindow::onLaunch()
@@ -374,6 +383,7 @@ bool MainWindow::_updateParams()
 
     _app->setOptions(_ui->testOnlyCB->isChecked(), _ui->delSrcCB->isChecked(),
                      _ui->debugCB->isChecked(), _ui->dispCompressionCB->isChecked());
+    _app->setNbJobs(_ui->jobsSB->value());
 
     return true;
 }
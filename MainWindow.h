@@ -55,6 +55,7 @@ public:
 
     void setIDLE();
     void setProgressMax(int max);
+    void updateProgressMax(int max);
     void setProgress(int value);
 
 
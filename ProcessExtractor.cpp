@@ -0,0 +1,160 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "ProcessExtractor.h"
+#include "FolderReport.h"
+#include <QDebug>
+
+ProcessExtractor::ProcessExtractor(Ex0days &app, QObject *parent):
+    Extractor(app, parent),
+    _proc(), _nbThreads(0), _run({0, QString(), 0, 0})
+{
+    connect(&_proc, &QProcess::started, this, [this](){
+        _run = {_proc.processId(), QFileInfo(_proc.program()).fileName(), FolderReport::now(), 0};
+    });
+    // the threads are released before finished so the next extraction can get them
+    connect(&_proc, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, &ProcessExtractor::_releaseThreads);
+    connect(&_proc, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, [this](){ _run.end = FolderReport::now(); });
+    connect(&_proc, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error){
+        if (error == QProcess::FailedToStart)
+        {
+            // QProcess won't emit finished: we do so the worker doesn't wait forever
+            // (queued as it may happen inside extract)
+            _releaseThreads();
+            _app._error(tr("Error running %1: %2").arg(_proc.program()).arg(_proc.errorString()));
+            QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection, Q_ARG(int, sExitNotStarted));
+        }
+    });
+    connect(&_proc, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, &Extractor::finished);
+
+    // 7z writes its errors on stderr, we need them to find the broken zip of a batch
+    _proc.setProcessChannelMode(QProcess::MergedChannels);
+}
+
+ProcessExtractor::~ProcessExtractor()
+{
+    if (_proc.state()!= QProcess::NotRunning)
+    {
+        _proc.terminate();
+        _proc.waitForFinished();
+    }
+}
+
+void ProcessExtractor::extract(Ex0days::ARCHIVE_TYPE type, const QFileInfoList &archives, const QString &outputDir)
+{
+    const QString &cmd = _extractCMD(type);
+
+    // in test mode the zips are still unzipped: the second stage needs the volumes
+    bool testOnly = _app._testOnly && type != Ex0days::ARCHIVE_TYPE::ZIP;
+    QStringList args = testOnly ? Ex0days::s7zTestArgs : Ex0days::s7zArgs;
+    if (type == Ex0days::ARCHIVE_TYPE::ZIP)
+    {
+        if (archives.size() == 1)
+            args << archives.first().absoluteFilePath();
+        else
+        {
+            // one single 7z for several zips: 7z x -y -an -ai!zip1 -ai!zip2...
+            args << "-an";
+            for (const QFileInfo &zip : archives)
+                args << QString("-ai!%1").arg(zip.absoluteFilePath());
+        }
+    }
+    else
+    {
+        if (type == Ex0days::ARCHIVE_TYPE::ARJ)
+            args << "-v"; // multi-volume
+        else if (_app._useWinrar && type == Ex0days::ARCHIVE_TYPE::RAR)
+            args << "-ibck";
+
+        args << archives.first().absoluteFilePath(); // the other volumes are found by the extractor
+    }
+
+    if (_isMultithreaded(type)) // unace and arj don't take anything from the budget
+    {
+        _nbThreads = _app._acquireThreads();
+        args.insert(1, _threadsArg(type)); // a switch: before the archives
+    }
+
+    qDebug() << cmd << " "  << args.join(" ");
+    _proc.setWorkingDirectory(outputDir); // the output goes in the working directory
+    _run = {0, QString(), 0, 0}; // set once started
+    _proc.start(cmd, args);
+}
+
+void ProcessExtractor::terminate()
+{
+    if (_proc.state()!= QProcess::NotRunning)
+        _proc.terminate();
+}
+
+bool ProcessExtractor::isRunning() const
+{
+    return _proc.state() != QProcess::NotRunning;
+}
+
+Extractor::ProcessRun ProcessExtractor::lastRun() const
+{
+    return _run;
+}
+
+QByteArray ProcessExtractor::readOutput()
+{
+    return _proc.readAllStandardOutput();
+}
+
+bool ProcessExtractor::_isMultithreaded(Ex0days::ARCHIVE_TYPE type)
+{
+    return type != Ex0days::ARCHIVE_TYPE::ACE && type != Ex0days::ARCHIVE_TYPE::ARJ;
+}
+
+QString ProcessExtractor::_threadsArg(Ex0days::ARCHIVE_TYPE type) const
+{
+    if (type == Ex0days::ARCHIVE_TYPE::RAR && !_app._unrarCmd.isEmpty())
+        return QString("-mt%1").arg(_nbThreads);
+    return QString("-mmt=%1").arg(_nbThreads);
+}
+
+void ProcessExtractor::_releaseThreads()
+{
+    if (_nbThreads)
+    {
+        _app._releaseThreads(_nbThreads);
+        _nbThreads = 0;
+    }
+}
+
+const QString &ProcessExtractor::_extractCMD(Ex0days::ARCHIVE_TYPE type) const
+{
+    switch (type) {
+    case Ex0days::ARCHIVE_TYPE::ACE:
+        return _app._unaceCmd;
+    case Ex0days::ARCHIVE_TYPE::RAR:
+        return _app._unrarCmd.isEmpty() ? _app._7zCmd : _app._unrarCmd;
+    case Ex0days::ARCHIVE_TYPE::ARJ:
+        return _app._arjCmd;
+    default:
+        return _app._7zCmd;
+    }
+}
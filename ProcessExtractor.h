@@ -0,0 +1,60 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef PROCESSEXTRACTOR_H
+#define PROCESSEXTRACTOR_H
+#include "Extractor.h"
+#include <QProcess>
+
+/*!
+ * \brief The ProcessExtractor class runs the external programs (7z, unrar, unace, arj)
+ */
+class ProcessExtractor : public Extractor
+{
+    Q_OBJECT
+
+private:
+    QProcess _proc;
+    int      _nbThreads; //!< taken from the thread budget of the app (cf --threads)
+    ProcessRun _run;
+
+public:
+    explicit ProcessExtractor(Ex0days &app, QObject *parent = nullptr);
+    ~ProcessExtractor() override;
+
+    void extract(Ex0days::ARCHIVE_TYPE type, const QFileInfoList &archives, const QString &outputDir) override;
+    void terminate() override;
+    bool isRunning() const override;
+    QByteArray readOutput() override;
+    ProcessRun lastRun() const override;
+
+private:
+    const QString &_extractCMD(Ex0days::ARCHIVE_TYPE type) const;
+    QString _threadsArg(Ex0days::ARCHIVE_TYPE type) const; //!< 7z or unrar switch
+    static bool _isMultithreaded(Ex0days::ARCHIVE_TYPE type);
+    void _releaseThreads();
+
+public:
+    static constexpr int sExitNotStarted = -1; //!< the program couldn't be run (missing, not executable...)
+};
+
+#endif // PROCESSEXTRACTOR_H
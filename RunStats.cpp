@@ -0,0 +1,95 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "RunStats.h"
+#include "FolderReport.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+
+RunStats::RunStats(): _groups() {}
+
+void RunStats::add(const FolderReport &report)
+{
+    if (report._workerId < 0)
+        return; // never started
+
+    Group &group = _groups[report._archiveType.isEmpty() ? QString("UNKNOWN") : report._archiveType];
+    ++group.nbFolders;
+    if (report._success)
+        _record(group.folder, report._end - report._start, report._inputBytes);
+    else
+        ++group.nbFailed;
+
+    for (const FolderReport::Stage &stage : report._stages)
+    {
+        if (stage.exitCode >= 0) // the interrupted ones would lower the stats
+            _record(group.stages[stage.name], stage.ms, stage.bytes);
+    }
+}
+
+QStringList RunStats::summary() const
+{
+    QStringList lines;
+    for (auto it = _groups.cbegin(), itEnd = _groups.cend(); it != itEnd; ++it)
+    {
+        const Group &group = it.value();
+        lines << QString("%1: %2 folders (%3 KO)").arg(it.key()).arg(group.nbFolders).arg(group.nbFailed);
+        if (group.folder.ms.count())
+            lines << _line("folder", group.folder);
+        for (auto itStage = group.stages.cbegin(), itStageEnd = group.stages.cend(); itStage != itStageEnd; ++itStage)
+            lines << _line(itStage.key(), itStage.value());
+    }
+    return lines;
+}
+
+QByteArray RunStats::toJsonLine(qint64 elapsedMs) const
+{
+    QJsonObject groups;
+    for (auto it = _groups.cbegin(), itEnd = _groups.cend(); it != itEnd; ++it)
+    {
+        const Group &group = it.value();
+        QJsonObject stages;
+        for (auto itStage = group.stages.cbegin(), itStageEnd = group.stages.cend(); itStage != itStageEnd; ++itStage)
+            stages[itStage.key()] = QJsonObject{{"ms", itStage.value().ms.toJson()}, {"kbps", itStage.value().kbps.toJson()}};
+        groups[it.key()] = QJsonObject{
+                {"folders", static_cast<int>(group.nbFolders)}, {"failed", static_cast<int>(group.nbFailed)},
+                {"folder", QJsonObject{{"ms", group.folder.ms.toJson()}, {"kbps", group.folder.kbps.toJson()}}},
+                {"stages", stages}};
+    }
+    QJsonObject summary{{"summary", QJsonObject{{"ms", elapsedMs}, {"archive_types", groups}}}};
+    return QJsonDocument(summary).toJson(QJsonDocument::Compact);
+}
+
+void RunStats::_record(Histograms &histograms, qint64 ms, qint64 bytes)
+{
+    histograms.ms.record(ms);
+    if (bytes > 0)
+        histograms.kbps.record(bytes * 1000 / 1024 / qMax<qint64>(1, ms));
+}
+
+QString RunStats::_line(const QString &name, const Histograms &histograms)
+{
+    QString line = QString("  - %1 x%2: %3 ms").arg(name, -9).arg(histograms.ms.count()).arg(histograms.ms.toString());
+    if (histograms.kbps.count())
+        line += QString(" | KB/s: %1").arg(histograms.kbps.toString());
+    return line;
+}
@@ -0,0 +1,75 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef RUNSTATS_H
+#define RUNSTATS_H
+#include "LatencyHistogram.h"
+#include <QMap>
+#include <QStringList>
+class FolderReport;
+
+/*!
+ * \brief The RunStats class aggregates the FolderReports of a run by type of second archive
+ * (RAR, ACE, ARJ, 7Z...) in LatencyHistograms: duration and throughput of the folders
+ * and of each of their stages, to compare the extractors and spot regressions.
+ * Printed at the end of the run and written as the last line of the JSON Lines report
+ */
+class RunStats
+{
+private:
+    struct Histograms
+    {
+        LatencyHistogram ms;
+        LatencyHistogram kbps; //!< input KB/s (for the ones that read something)
+    };
+    struct Group
+    {
+        uint                       nbFolders;
+        uint                       nbFailed;
+        Histograms                 folder;  //!< successful folders only
+        QMap<QString, Histograms>  stages;  //!< finished stages (failures included)
+
+        Group(): nbFolders(0), nbFailed(0), folder(), stages() {}
+    };
+
+    QMap<QString, Group> _groups;
+
+public:
+    RunStats();
+
+    inline void clear();
+    inline bool isEmpty() const;
+
+    void add(const FolderReport &report);
+
+    QStringList summary() const;
+    QByteArray toJsonLine(qint64 elapsedMs) const;
+
+private:
+    static void _record(Histograms &histograms, qint64 ms, qint64 bytes);
+    static QString _line(const QString &name, const Histograms &histograms);
+};
+
+void RunStats::clear() { _groups.clear(); }
+bool RunStats::isEmpty() const { return _groups.isEmpty(); }
+
+#endif // RUNSTATS_H
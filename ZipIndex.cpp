@@ -0,0 +1,374 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "ZipIndex.h"
+#include <QFileInfo>
+#include <QFile>
+#include <QMap>
+#include <QHash>
+
+namespace {
+
+inline quint16 le16(const uchar *data) { return static_cast<quint16>(data[0] | (data[1] << 8)); }
+inline quint32 le32(const uchar *data) { return le16(data) | (static_cast<quint32>(le16(data + 2)) << 16); }
+inline quint64 le64(const uchar *data) { return le32(data) | (static_cast<quint64>(le32(data + 4)) << 32); }
+
+//! the scheme of a volume name and the first number it should start from
+struct VolumeScheme
+{
+    const char *name;
+    int         firstIndex;
+};
+const VolumeScheme sPartScheme = {"part", 1}; //!< name.part01.rar, name.part02.rar...
+const VolumeScheme sRarScheme  = {"rar",  0}; //!< name.rar, name.r00, name.r01... name.s00...
+const VolumeScheme sAceScheme  = {"ace",  0}; //!< name.ace, name.c00, name.c01...
+const VolumeScheme sArjScheme  = {"arj",  0}; //!< name.arj, name.a01, name.a02...
+const VolumeScheme sNumScheme  = {"num",  1}; //!< name.001, name.002... (name.7z.001...)
+const VolumeScheme s7zScheme   = {"7z",   0}; //!< name.7z alone (its splits are name.7z.001...)
+
+//! region of a file mapped in memory (or read if it can't be mapped)
+class FileRegion
+{
+private:
+    QFile      &_file;
+    uchar      *_map;
+    QByteArray  _buffer;
+    qint64      _size;
+
+public:
+    FileRegion(QFile &file, qint64 offset, qint64 size):
+        _file(file), _map(size > 0 ? file.map(offset, size) : nullptr), _buffer(), _size(size)
+    {
+        if (!_map)
+        {
+            if (file.seek(offset))
+                _buffer = file.read(size);
+            _size = _buffer.size();
+        }
+    }
+    ~FileRegion()
+    {
+        if (_map)
+            _file.unmap(_map);
+    }
+
+    const uchar *data() const { return _map ? _map : reinterpret_cast<const uchar*>(_buffer.constData()); }
+    qint64 size() const { return _size; }
+};
+
+struct Volume
+{
+    QString                zip;
+    const ZipIndex::Entry *entry;
+};
+
+struct VolumeSet
+{
+    QString                  name;    //!< as found in the first volume we met
+    const VolumeScheme      *scheme;
+    QMap<int, QList<Volume>> volumes; //!< by index
+    bool                     anchored; //!< one of them is surely an archive (name.rar, name.7z.001...)
+};
+
+bool isNumber(const QString &str, int from, int &number)
+{
+    if (from >= str.size())
+        return false;
+    bool ok = false;
+    number = str.mid(from).toInt(&ok);
+    for (int i = from; ok && i < str.size(); ++i)
+        ok = str.at(i).isDigit();
+    return ok;
+}
+
+//! the set a volume belongs to (base name + scheme) and its index in it
+//! anchor tells if the name is surely the one of an archive (not a payload file like lib.so.3 or x.c10)
+bool volumeIndex(const QString &fileName, QString &setKey, const VolumeScheme *&scheme, int &index, bool &anchor)
+{
+    QString name = fileName.toLower();
+    int number = 0;
+    anchor = true;
+    if (name.endsWith(".rar"))
+    {
+        QString stem = name.left(name.size() - 4);
+        int dot = stem.lastIndexOf('.');
+        if (dot >= 0 && stem.mid(dot + 1).startsWith("part") && isNumber(stem, dot + 5, number))
+        {
+            setKey = stem.left(dot);
+            scheme = &sPartScheme;
+            index  = number;
+        }
+        else
+        {
+            setKey = stem;
+            scheme = &sRarScheme;
+            index  = 0;
+        }
+        return true;
+    }
+    if (name.endsWith(".ace") || name.endsWith(".arj"))
+    {
+        setKey = name.left(name.size() - 4);
+        scheme = name.endsWith(".ace") ? &sAceScheme : &sArjScheme;
+        index  = 0;
+        return true;
+    }
+    if (name.endsWith(".7z"))
+    {
+        setKey = name; // not in the set of name.7z.001 that has its own first volume
+        scheme = &s7zScheme;
+        index  = 0;
+        return true;
+    }
+
+    int dot = name.lastIndexOf('.');
+    if (dot < 0 || dot + 1 >= name.size())
+        return false;
+    setKey = name.left(dot);
+    anchor = setKey.endsWith(".7z");
+    QChar letter = name.at(dot + 1);
+    if (isNumber(name, dot + 1, number))
+    {
+        scheme = &sNumScheme;
+        index  = number;
+    }
+    else if (!isNumber(name, dot + 2, number) || name.size() - dot - 2 < 2)
+        return false;
+    else if (letter == 'r' || letter == 's')
+    {
+        scheme = &sRarScheme;
+        index  = 1 + number + (letter == 's' ? 100 : 0); // name.rar, r00..r99, s00..
+    }
+    else if (letter == 'c')
+    {
+        scheme = &sAceScheme;
+        index  = 1 + number;
+    }
+    else if (letter == 'a')
+    {
+        scheme = &sArjScheme;
+        index  = number;
+    }
+    else
+        return false;
+    return true;
+}
+
+}
+
+ZipIndex::ZipIndex():
+    _fileName(), _entries(), _unzippedSize(0), _error()
+{}
+
+bool ZipIndex::read(const QFileInfo &zip)
+{
+    _fileName = zip.fileName();
+    _entries.clear();
+    _unzippedSize = 0;
+    _error.clear();
+
+    QFile file(zip.absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        _error = tr("can't be read (%1)").arg(file.errorString());
+        return false;
+    }
+
+    // End Of Central Directory: at the tail, before the comment
+    qint64 fileSize = file.size();
+    qint64 tailSize = qMin<qint64>(fileSize, sEOCDSize + sMaxCommentSize);
+    FileRegion tail(file, fileSize - tailSize, tailSize);
+    const uchar *data = tail.data();
+    int eocdPos = static_cast<int>(tail.size()) - sEOCDSize;
+    while (eocdPos >= 0 && le32(data + eocdPos) != 0x06054b50)
+        --eocdPos;
+    if (eocdPos < 0)
+    {
+        _error = tr("truncated (no end of central directory)");
+        return false;
+    }
+
+    const uchar *eocd = data + eocdPos;
+    qint64  eocdOffset = fileSize - tailSize + eocdPos;
+    quint64 nbEntries  = le16(eocd + 10);
+    quint64 cdSize     = le32(eocd + 12);
+    quint64 cdOffset   = le32(eocd + 16);
+    if (le16(eocd + 4) != 0 || le16(eocd + 6) != 0)
+        return true; // spanned zip (name.z01...): 7z will tell
+
+    if (nbEntries == 0xFFFF || cdSize == 0xFFFFFFFF || cdOffset == 0xFFFFFFFF)
+    {
+        // ZIP64: the locator is just before the EOCD and points to the ZIP64 EOCD record
+        qint64 recordOffset = eocdPos >= 20 && le32(eocd - 20) == 0x07064b50 ? static_cast<qint64>(le64(eocd - 20 + 8)) : -1;
+        if (recordOffset < 0 || recordOffset + 56 > eocdOffset)
+        {
+            _error = tr("corrupted ZIP64 end of central directory");
+            return false;
+        }
+        FileRegion record(file, recordOffset, 56);
+        const uchar *zip64 = record.data();
+        if (record.size() < 56 || le32(zip64) != 0x06064b50)
+        {
+            _error = tr("corrupted ZIP64 end of central directory");
+            return false;
+        }
+        nbEntries  = le64(zip64 + 32);
+        cdSize     = le64(zip64 + 40);
+        cdOffset   = le64(zip64 + 48);
+        eocdOffset = recordOffset;
+    }
+
+    if (cdOffset + cdSize > static_cast<quint64>(eocdOffset) || cdSize > sMaxCentralDirSize)
+    {
+        _error = tr("truncated (central directory out of the file)");
+        return false;
+    }
+
+    FileRegion centralDir(file, static_cast<qint64>(cdOffset), static_cast<qint64>(cdSize));
+    if (static_cast<quint64>(centralDir.size()) != cdSize)
+    {
+        _error = tr("truncated (central directory)");
+        return false;
+    }
+
+    data = centralDir.data();
+    int pos = 0, size = static_cast<int>(centralDir.size());
+    while (pos + 46 <= size && le32(data + pos) == 0x02014b50)
+    {
+        const uchar *header = data + pos;
+        int nameSize = le16(header + 28), extraSize = le16(header + 30), commentSize = le16(header + 32);
+        if (pos + 46 + nameSize + extraSize + commentSize > size)
+            break;
+
+        Entry entry;
+        QByteArray name(reinterpret_cast<const char*>(header + 46), nameSize);
+        entry.name           = (le16(header + 8) & 0x0800) ? QString::fromUtf8(name) : QString::fromLatin1(name);
+        entry.crc            = le32(header + 16);
+        entry.compressedSize = le32(header + 20);
+        entry.size           = le32(header + 24);
+        entry.offset         = le32(header + 42);
+
+        // ZIP64 extra field: the 64 bits values of the ones that are 0xFFFFFFFF (in that order)
+        const uchar *extra = header + 46 + nameSize, *extraEnd = extra + extraSize;
+        while (extra + 4 <= extraEnd)
+        {
+            int fieldSize = le16(extra + 2);
+            if (le16(extra) == 0x0001)
+            {
+                const uchar *value = extra + 4, *valueEnd = qMin(value + fieldSize, extraEnd);
+                for (quint64 *field : {&entry.size, &entry.compressedSize, &entry.offset})
+                {
+                    if (*field == 0xFFFFFFFF && value + 8 <= valueEnd)
+                    {
+                        *field = le64(value);
+                        value += 8;
+                    }
+                }
+            }
+            extra += 4 + fieldSize;
+        }
+
+        // the data must end before the central directory (local header of at least 30 bytes + name)
+        if (entry.offset + 30 + static_cast<quint64>(nameSize) + entry.compressedSize > cdOffset)
+        {
+            _error = tr("truncated (%1 is incomplete)").arg(entry.name);
+            return false;
+        }
+
+        _entries << entry;
+        _unzippedSize += static_cast<qint64>(entry.size);
+        pos += 46 + nameSize + extraSize + commentSize;
+    }
+
+    if (static_cast<quint64>(_entries.size()) != nbEntries)
+    {
+        _error = tr("corrupted central directory (%1 entries instead of %2)").arg(_entries.size()).arg(nbEntries);
+        return false;
+    }
+    return true;
+}
+
+QString ZipIndex::checkVolumeSets(const QList<ZipIndex> &zips)
+{
+    QHash<QString, VolumeSet> sets;
+    for (const ZipIndex &zip : zips)
+    {
+        for (const Entry &entry : zip._entries)
+        {
+            if (entry.name.endsWith('/'))
+                continue; // folder
+
+            QString fileName = entry.name.section('/', -1), setKey;
+            const VolumeScheme *scheme = nullptr;
+            int index = 0;
+            bool anchor = false;
+            if (!volumeIndex(fileName, setKey, scheme, index, anchor))
+                continue;
+
+            setKey += QString("|%1").arg(scheme->name);
+            auto it = sets.find(setKey);
+            if (it == sets.end())
+                it = sets.insert(setKey, {fileName, scheme, QMap<int, QList<Volume>>(), false});
+            it->volumes[index] << Volume{zip._fileName, &entry};
+            it->anchored |= anchor;
+        }
+    }
+
+    QStringList problems;
+    for (const VolumeSet &set : sets)
+    {
+        if (!set.anchored && set.volumes.size() < 2)
+            continue; // a lone payload file (lib.so.3, data.1...) is not a split archive
+
+        const int first = set.volumes.firstKey();
+        // name.000 or name.001 are both used as the first volume of a split
+        int expected = set.scheme == &sNumScheme ? qMin(first, 1) : set.scheme->firstIndex;
+        QList<int> missing;
+        for (auto it = set.volumes.cbegin(), itEnd = set.volumes.cend(); it != itEnd; ++it)
+        {
+            while (expected < it.key())
+                missing << expected++;
+            expected = it.key() + 1;
+
+            // the same volume in two zips is fine as long as it's the same file
+            const QList<Volume> &volumes = it.value();
+            for (const Volume &volume : volumes)
+            {
+                const Entry *entry = volume.entry, *ref = volumes.first().entry;
+                if (entry->crc != ref->crc || entry->size != ref->size || entry->name != ref->name)
+                {
+                    problems << tr("duplicate volume %1 (%2 in %3 and %4 in %5)").arg(
+                                    it.key()).arg(ref->name).arg(volumes.first().zip).arg(entry->name).arg(volume.zip);
+                    break;
+                }
+            }
+        }
+        if (!missing.isEmpty())
+        {
+            QStringList numbers;
+            for (int index : missing)
+                numbers << QString::number(index);
+            problems << tr("missing volumes of %1: %2").arg(set.name).arg(numbers.join(", "));
+        }
+    }
+    problems.sort();
+    return problems.join(" / ");
+}
@@ -0,0 +1,81 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef ZIPINDEX_H
+#define ZIPINDEX_H
+#include <QCoreApplication>
+#include <QString>
+#include <QList>
+class QFileInfo;
+
+/*!
+ * \brief The ZipIndex class reads the central directory of a zip in place
+ * (End Of Central Directory at the tail, ZIP64 included) to list its entries without unzipping it
+ * only the tail and the central directory are mapped in memory (read if the mapping fails)
+ * It's done during the discovery (cf FolderEntry) to know what a folder will produce
+ * and for the pre-flight of the folders: checkVolumeSets tells if the volumes
+ * of the second archives are all there before we copy or unzip anything
+ */
+class ZipIndex
+{
+    Q_DECLARE_TR_FUNCTIONS(ZipIndex)
+
+public:
+    struct Entry
+    {
+        QString name;
+        quint32 crc;
+        quint64 compressedSize;
+        quint64 size;
+        quint64 offset; //!< of the local header
+    };
+
+private:
+    QString      _fileName;
+    QList<Entry> _entries;
+    qint64       _unzippedSize; //!< total of the entries
+    QString      _error;    //!< why the zip can't be used (truncated...)
+
+public:
+    ZipIndex();
+
+    bool read(const QFileInfo &zip); //!< false if the zip is truncated or corrupted (cf error())
+
+    inline const QString &fileName() const;
+    inline const QList<Entry> &entries() const;
+    inline qint64 unzippedSize() const;
+    inline const QString &error() const;
+
+    //! missing or duplicate volumes among the entries of the zips of a folder (empty if none)
+    static QString checkVolumeSets(const QList<ZipIndex> &zips);
+
+private:
+    static constexpr int    sEOCDSize        = 22;
+    static constexpr int    sMaxCommentSize  = 0xFFFF;
+    static constexpr qint64 sMaxCentralDirSize = 64 * 1024 * 1024; //!< more would be a corrupted zip
+};
+
+const QString &ZipIndex::fileName() const { return _fileName; }
+const QList<ZipIndex::Entry> &ZipIndex::entries() const { return _entries; }
+qint64 ZipIndex::unzippedSize() const { return _unzippedSize; }
+const QString &ZipIndex::error() const { return _error; }
+
+#endif // ZIPINDEX_H
@@ -0,0 +1,95 @@
+#!/bin/bash
+#========================================================================
+#
+# Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+#
+# This file is a part of ex0days : https://github.com/mbruel/ex0days
+#
+# ex0days is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as
+# published by the Free Software Foundation; version 3.0 of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+# You should have received a copy of the GNU Lesser General Public
+# License along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+# USA.
+#
+#========================================================================
+
+# Scenario of --in-place (the zips are moved, not copied): a folder aborted in the middle
+# of its unzips must get back all its zips, whether it is stopped (two SIGINT) or killed
+# (SIGKILL then the rollback of the journal when ex0days restarts)
+# Usage: InPlaceRollback.sh <path of ex0days> [7z]
+# it needs 7z and zip, exits with 0 if every zip is back in the source folder
+
+EX0DAYS=${1:?"Usage: $0 <path of ex0days> [7z]"}
+Z7=${2:-7z}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# a 0day: 7z volumes zipped one by one (big enough to be interrupted during the unzips)
+makeFolder()
+{
+    local folder=$WORK/src/release
+    rm -rf "$WORK/src" "$WORK/out" && mkdir -p "$folder" "$WORK/out" "$WORK/tmp"
+    head -c 200M /dev/urandom > "$WORK/tmp/payload.bin"
+    (cd "$WORK/tmp" && "$Z7" a -mx0 -v10m payload.7z payload.bin > /dev/null)
+    for volume in "$WORK"/tmp/payload.7z.*; do
+        (cd "$WORK/tmp" && zip -0 -q "$folder/$(basename "$volume").zip" "$(basename "$volume")")
+    done
+    rm -rf "$WORK/tmp"
+    (cd "$folder" && sha1sum ./*.zip) > "$WORK/zips.sha1"
+}
+
+# wait until the first zips are unzipped (their volumes are in the output)
+waitForUnzips()
+{
+    for _ in $(seq 1 600); do
+        if [ -n "$(find "$WORK/out" -name 'payload.7z.0*' -not -name '*.zip' 2> /dev/null | head -1)" ]; then
+            sleep 0.5
+            return 0
+        fi
+        sleep 0.1
+    done
+    echo "the unzips have not started" && return 1
+}
+
+checkZips()
+{
+    if (cd "$WORK/src/release" && sha1sum --quiet -c "$WORK/zips.sha1"); then
+        echo "$1: OK, all the zips are back"
+    else
+        echo "$1: KO, some zips are lost"
+        exit 1
+    fi
+}
+
+run()
+{
+    # from $WORK: the journal is in ./logs
+    (cd "$WORK" && "$EX0DAYS" -i "$WORK/src" -o "$WORK/out" --in-place --del --unzip-jobs 1 --7z "$(command -v "$Z7")")
+}
+
+# stopped: the first signal drains, the second stops the folder (rollback by the worker)
+makeFolder
+run > "$WORK/stop.log" 2>&1 &
+pid=$!
+waitForUnzips || exit 1
+kill -INT $pid; sleep 0.2; kill -INT $pid
+wait $pid
+checkZips "stopped"
+
+# killed: the rollback is done from the journal by the next run
+makeFolder
+run > "$WORK/kill.log" 2>&1 &
+pid=$!
+waitForUnzips || exit 1
+kill -KILL $pid
+wait $pid 2> /dev/null
+# the journal is replayed before the input folders are checked: a missing one stops there
+(cd "$WORK" && "$EX0DAYS" -i "$WORK/missing" -o "$WORK/out" --7z "$(command -v "$Z7")" > "$WORK/recover.log" 2>&1)
+checkZips "killed"
@@ -0,0 +1,208 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ex0days : https://github.com/mbruel/ex0days
+//
+// ex0days is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+// Micro-benchmark of the classification of the volume names (ArchiveDetector::detectName)
+// against the former regular expressions of FolderWorker::_findArchiveType
+// Usage: NameClassifierBench [file with one name per line]
+// (without file, it uses a corpus built from the usual naming schemes of the 0days)
+
+#include "ArchiveDetector.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QFile>
+
+namespace {
+
+//! the former implementation (before ArchiveDetector::detectName)
+ArchiveDetector::Detection regExpDetectName(const QString &fileName)
+{
+    static const QRegularExpression sRegExpArchiveExtensions("^.*\\.(rar|ace|arj|7z)$");
+    static const QRegularExpression sRegExpArchiveFiles("^(.*)\\.(part)?(([rac])?\\d+)(\\.rar)?$");
+    static const QRegularExpression sRegExpNumberOne("^0*1$");
+
+    ARCHIVE_TYPE type = ARCHIVE_TYPE::UNKNOWN;
+    bool firstArchive = false;
+    QString fileNameLowerCase = fileName.toLower();
+
+    QRegularExpressionMatch match = sRegExpArchiveExtensions.match(fileNameLowerCase);
+    if (match.hasMatch())
+    {
+        firstArchive = true;
+        QString ext = match.captured(1);
+        if (ext == "rar")
+            type = ARCHIVE_TYPE::RAR;
+        else if (ext == "ace")
+            type = ARCHIVE_TYPE::ACE;
+        else if (ext == "7z")
+            type = ARCHIVE_TYPE::Z7;
+        else
+            type = ARCHIVE_TYPE::ARJ;
+    }
+
+    if (type == ARCHIVE_TYPE::UNKNOWN || type == ARCHIVE_TYPE::RAR)
+    {
+        match = sRegExpArchiveFiles.match(fileNameLowerCase);
+        if (match.hasMatch())
+        {
+            QString baseName       = match.captured(1);
+            QString newRar         = match.captured(2);
+            QString number         = match.captured(3);
+            QString oldStyleLetter = match.captured(4);
+            QString rarExtenstion  = match.captured(5);
+
+            if (!newRar.isEmpty())
+                type = ARCHIVE_TYPE::RAR;
+            else if (baseName.endsWith(".7z"))
+                type = ARCHIVE_TYPE::Z7;
+            else if (!oldStyleLetter.isEmpty())
+            {
+                const QChar &letter = oldStyleLetter.at(0);
+                if (letter == 'r')
+                    type = ARCHIVE_TYPE::RAR;
+                else if (letter == 'a')
+                    type = ARCHIVE_TYPE::ARJ;
+                else
+                    type = ARCHIVE_TYPE::ACE;
+            }
+            else if (!number.isEmpty())
+                type = ARCHIVE_TYPE::RAR;
+
+            if (type == ARCHIVE_TYPE::RAR || type == ARCHIVE_TYPE::Z7)
+            {
+                if (!rarExtenstion.isEmpty() && newRar.isEmpty())
+                    firstArchive = true;
+                else
+                    firstArchive = sRegExpNumberOne.match(number).hasMatch();
+            }
+        }
+    }
+    return {type, firstArchive ? ArchiveDetector::FIRST::YES : ArchiveDetector::FIRST::NO};
+}
+
+QStringList buildCorpus()
+{
+    const QStringList releases = {
+        "Some.Software.v2.1.0.Incl.Keygen-GROUP", "Another_App_3.5_Multilingual", "tool-v1.0.x64",
+        "Great.Game.Update.1.2-CODEX", "ebook.collection.2020", "Plugin.Bundle.2019.10.WiN.MAC-XYZ",
+        "app", "A.B.C.D.E.F.G", "some.7z.fake", "Photo_Editor_Pro_12.0.3_Portable", "SOFT.V9-DVT",
+        "Utility.2.0.part.of.a.series", "Driver.Pack.17.11.05", "ÉditeurDeTexte.v4", "Дистрибутив.1.0"
+    };
+
+    QStringList corpus;
+    for (const QString &release : releases)
+    {
+        corpus << release + ".rar" << release + ".RAR" << release + ".7z" << release + ".ace"
+               << release + ".arj" << release + ".nfo" << release + ".sfv" << release + ".zip"
+               << release + ".diz" << release + ".txt" << "file_id.diz" << release + ".exe";
+        for (int i = 0; i < 40; ++i)
+        {
+            QString num2 = QString::number(i).rightJustified(2, '0');
+            QString num3 = QString::number(i + 1).rightJustified(3, '0');
+            corpus << QString("%1.r%2").arg(release).arg(num2)
+                   << QString("%1.part%2.rar").arg(release).arg(QString::number(i + 1).rightJustified(2, '0'))
+                   << QString("%1.part%2.rar").arg(release).arg(num3)
+                   << QString("%1.Part%2.RAR").arg(release).arg(i + 1)
+                   << QString("%1.7z.%2").arg(release).arg(num3)
+                   << QString("%1.%2").arg(release).arg(num3)
+                   << QString("%1.c%2").arg(release).arg(num2)
+                   << QString("%1.a%2").arg(release).arg(num2)
+                   << QString("%1.s%2").arg(release).arg(num2)
+                   << QString("%1.%2.rar").arg(release).arg(num3);
+        }
+    }
+    corpus << ".rar" << "rar" << "x.part" << "x.part.rar" << "x.partr1" << "x.r" << "x." << "x.7z." << "x.c"
+           << "x.part1" << "x.parta01.rar" << "noextension" << "x.7z.rar" << "x.0" << "x.1" << "x.a1.rar";
+    return corpus;
+}
+
+template<typename Classifier>
+double namesPerSec(const QStringList &corpus, int rounds, Classifier classify, int &checksum)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int round = 0; round < rounds; ++round)
+    {
+        for (const QString &name : corpus)
+        {
+            ArchiveDetector::Detection detection = classify(name);
+            checksum += static_cast<int>(detection.type) + static_cast<int>(detection.first);
+        }
+    }
+    qint64 elapsed = timer.nsecsElapsed();
+    return elapsed ? static_cast<double>(corpus.size()) * rounds * 1e9 / elapsed : 0.;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream cout(stdout);
+
+    QStringList corpus;
+    if (argc > 1)
+    {
+        QFile file(QString::fromLocal8Bit(argv[1]));
+        if (!file.open(QIODevice::ReadOnly|QIODevice::Text))
+        {
+            cout << "Error opening " << file.fileName() << "\n";
+            return 1;
+        }
+        while (!file.atEnd())
+        {
+            QString name = QString::fromUtf8(file.readLine()).trimmed();
+            if (!name.isEmpty())
+                corpus << name;
+        }
+    }
+    else
+        corpus = buildCorpus();
+    if (corpus.isEmpty())
+        return 1;
+
+    int nbDiffs = 0;
+    for (const QString &name : corpus)
+    {
+        ArchiveDetector::Detection fast = ArchiveDetector::detectName(name), slow = regExpDetectName(name);
+        if (fast.type != slow.type || fast.first != slow.first)
+        {
+            ++nbDiffs;
+            cout << "DIFF " << name
+                 << ": detectName = " << archiveTypeName(fast.type) << (fast.first == ArchiveDetector::FIRST::YES ? " (first)" : "")
+                 << ", regexp = " << archiveTypeName(slow.type) << (slow.first == ArchiveDetector::FIRST::YES ? " (first)" : "")
+                 << "\n";
+        }
+    }
+
+    const int rounds = qMax(1, 2000000 / corpus.size());
+    int checksum = 0;
+    double regExpRate = namesPerSec(corpus, rounds, regExpDetectName, checksum);
+    double fastRate   = namesPerSec(corpus, rounds, ArchiveDetector::detectName, checksum);
+
+    cout << corpus.size() << " names x " << rounds << " rounds (checksum " << checksum << ")\n"
+         << "  regexp     : " << QString::number(regExpRate, 'f', 0) << " names/sec\n"
+         << "  detectName : " << QString::number(fastRate, 'f', 0) << " names/sec (x"
+         << QString::number(regExpRate > 0 ? fastRate / regExpRate : 0., 'f', 1) << ")\n"
+         << "  differences: " << nbDiffs << "\n";
+    return nbDiffs ? 2 : 0;
+}
@@ -0,0 +1,21 @@
+# micro-benchmark of the volume name classifier (qmake && make && ./NameClassifierBench [names.txt])
+QT += core
+QT -= gui
+
+TARGET = NameClassifierBench
+TEMPLATE = app
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+DEFINES += QT_NO_DEBUG_OUTPUT
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    NameClassifierBench.cpp \
+    ../ArchiveDetector.cpp
+
+HEADERS += \
+    ../ArchiveDetector.h \
+    ../ArchiveType.h
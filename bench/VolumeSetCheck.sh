@@ -0,0 +1,65 @@
+#!/bin/bash
+#========================================================================
+#
+# Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+#
+# This file is a part of ex0days : https://github.com/mbruel/ex0days
+#
+# ex0days is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as
+# published by the Free Software Foundation; version 3.0 of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+# You should have received a copy of the GNU Lesser General Public
+# License along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+# USA.
+#
+#========================================================================
+
+# Scenario of the pre-flight of the volume sets (ZipIndex::checkVolumeSets):
+#   - a folder whose zip only holds payload files with numeric extensions (lib.so.3, data.1...)
+#     has no second archive and must be extracted, not reported with missing volumes
+#   - a folder with a real split archive missing a volume must still be refused
+# Usage: VolumeSetCheck.sh <path of ex0days> [7z]
+# it needs 7z and zip, exits with 0 if both folders get the expected result
+
+EX0DAYS=${1:?"Usage: $0 <path of ex0days> [7z]"}
+Z7=${2:-7z}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# the payload: no volume in there even if the extensions look like some
+mkdir -p "$WORK/src/payload" "$WORK/src/missing" "$WORK/out" "$WORK/tmp"
+for file in lib.so.3 data.1 track.a52 x.c10 notes.r2; do
+    head -c 1K /dev/urandom > "$WORK/tmp/$file"
+done
+(cd "$WORK/tmp" && zip -q "$WORK/src/payload/payload.zip" lib.so.3 data.1 track.a52 x.c10 notes.r2)
+
+# a rar set without its second part (the content doesn't matter: it's refused before any unzip)
+for volume in release.part1.rar release.part3.rar; do
+    head -c 1K /dev/urandom > "$WORK/tmp/$volume"
+    (cd "$WORK/tmp" && zip -q "$WORK/src/missing/$volume.zip" "$volume")
+done
+
+# from $WORK: the csv of the KO folders is in ./logs
+(cd "$WORK" && "$EX0DAYS" -i "$WORK/src" -o "$WORK/out" --7z "$(command -v "$Z7")" > "$WORK/run.log" 2>&1)
+csv=$(cat "$WORK"/logs/*.csv 2> /dev/null)
+
+result=0
+if echo "$csv" | grep -q "payload" || [ -z "$(find "$WORK/out" -name lib.so.3)" ]; then
+    echo "payload files: KO, the folder has not been extracted"
+    result=1
+else
+    echo "payload files: OK"
+fi
+if echo "$csv" | grep "missing" | grep -q "missing volumes"; then
+    echo "missing volume: OK"
+else
+    echo "missing volume: KO, the folder has not been refused"
+    result=1
+fi
+exit $result
@@ -30,9 +30,9 @@
 void handleShutdown(int signal)
 {
     Q_UNUSED(signal)
-    std::cout << "Closing the application...\n";
-    std::cout.flush();
-    qApp->quit();
+    // only async-signal-safe: Ex0days polls it from the event loop
+    // (1st signal: finish the running folders, 2nd one: abort them)
+    ++Ex0days::sShutdownRequests;
 }
 
 